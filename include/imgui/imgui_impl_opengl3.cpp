@@ -5,6 +5,7 @@
 
 // Implemented features:
 //  [X] Renderer: User texture binding. Use 'GLuint' OpenGL texture identifier as void*/ImTextureID. Read the FAQ about ImTextureID in imgui.cpp.
+//  [X] Renderer: Optional ring-buffered vertex streaming, see ImGui_ImplOpenGL3_SetRingBuffer().
 
 // You can copy and use unmodified imgui_impl_* files in your project. See main.cpp for an example of using this.
 // If you are new to dear imgui, read examples/README.txt and read the documentation at the top of imgui.cpp.
@@ -12,6 +13,7 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  2026-10-19: OpenGL: Added ImGui_ImplOpenGL3_SetRingBuffer() to upload a whole frame into one fenced ring VBO/IBO and draw with glDrawElementsBaseVertex.
 //  2019-03-03: OpenGL: Fix support for ES 2.0 (WebGL 1.0).
 //  2019-02-20: OpenGL: Fix for OSX not supporting OpenGL 4.5, we don't try to read GL_CLIP_ORIGIN even if defined by the headers/loader.
 //  2019-02-11: OpenGL: Projecting clipping rectangles correctly using draw_data->FramebufferScale to allow multi-viewports for retina display.
@@ -99,6 +101,11 @@
 #endif
 #endif
 
+// Ring-buffered streaming needs glMapBufferRange, fences and glDrawElementsBaseVertex (desktop GL 3.2)
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3)
+#define IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+#endif
+
 // OpenGL Data
 static char         g_GlslVersionString[32] = "";
 static GLuint       g_FontTexture = 0;
@@ -107,6 +114,20 @@ static int          g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;
 static int          g_AttribLocationPosition = 0, g_AttribLocationUV = 0, g_AttribLocationColor = 0;
 static unsigned int g_VboHandle = 0, g_ElementsHandle = 0;
 
+// Ring buffer data: the buffers are split in IMGUI_IMPL_OPENGL_RING_FRAMES segments, one per frame in flight,
+// each guarded by a fence so we only write to a segment once the GPU is done reading it.
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+#define IMGUI_IMPL_OPENGL_RING_FRAMES 3
+static bool         g_RingEnabled = false;
+static bool         g_RingPersistent = false;                       // GL 4.4 persistent + coherent mapping, else map each frame
+static GLuint       g_RingVboHandle = 0, g_RingElementsHandle = 0;
+static size_t       g_RingVtxSegmentSize = 0, g_RingIdxSegmentSize = 0;   // in bytes
+static char*        g_RingVtxMapped = NULL;
+static char*        g_RingIdxMapped = NULL;
+static GLsync       g_RingFences[IMGUI_IMPL_OPENGL_RING_FRAMES] = {};
+static int          g_RingFrame = 0;
+#endif
+
 // Functions
 bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
 {
@@ -131,6 +152,143 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
     return true;
 }
 
+void    ImGui_ImplOpenGL3_SetRingBuffer(bool enabled)
+{
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+    g_RingEnabled = enabled;
+#else
+    (void)enabled;
+#endif
+}
+
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+static void ImGui_ImplOpenGL3_DestroyRingBuffers()
+{
+    for (int n = 0; n < IMGUI_IMPL_OPENGL_RING_FRAMES; n++)
+    {
+        if (g_RingFences[n]) glDeleteSync(g_RingFences[n]);
+        g_RingFences[n] = 0;
+    }
+    // Deleting a buffer also unmaps it
+    if (g_RingVboHandle) glDeleteBuffers(1, &g_RingVboHandle);
+    if (g_RingElementsHandle) glDeleteBuffers(1, &g_RingElementsHandle);
+    g_RingVboHandle = g_RingElementsHandle = 0;
+    g_RingVtxMapped = g_RingIdxMapped = NULL;
+    g_RingVtxSegmentSize = g_RingIdxSegmentSize = 0;
+    g_RingFrame = 0;
+}
+
+static GLuint ImGui_ImplOpenGL3_CreateRingBuffer(size_t size, char** out_mapped)
+{
+    // GL_COPY_WRITE_BUFFER so we don't disturb the vertex/element bindings of whatever VAO is bound
+    GLuint handle = 0;
+    glGenBuffers(1, &handle);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle);
+    *out_mapped = NULL;
+    if (g_RingPersistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, NULL, flags);
+        *out_mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)size, flags);
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return handle;
+}
+
+// (Re)create the ring so that one segment holds at least vtx_size/idx_size bytes. Growing drops the old buffers,
+// the driver keeps them alive until the GPU has finished with frames still in flight.
+static void ImGui_ImplOpenGL3_CreateRingBuffers(size_t vtx_size, size_t idx_size)
+{
+    size_t vtx_segment = g_RingVtxSegmentSize ? g_RingVtxSegmentSize : 64 * 1024 * sizeof(ImDrawVert);
+    size_t idx_segment = g_RingIdxSegmentSize ? g_RingIdxSegmentSize : 128 * 1024 * sizeof(ImDrawIdx);
+    while (vtx_segment < vtx_size) vtx_segment *= 2;
+    while (idx_segment < idx_size) idx_segment *= 2;
+    ImGui_ImplOpenGL3_DestroyRingBuffers();
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    g_RingPersistent = major > 4 || (major == 4 && minor >= 4);
+
+    g_RingVboHandle = ImGui_ImplOpenGL3_CreateRingBuffer(vtx_segment * IMGUI_IMPL_OPENGL_RING_FRAMES, &g_RingVtxMapped);
+    g_RingElementsHandle = ImGui_ImplOpenGL3_CreateRingBuffer(idx_segment * IMGUI_IMPL_OPENGL_RING_FRAMES, &g_RingIdxMapped);
+    if (g_RingPersistent && (!g_RingVtxMapped || !g_RingIdxMapped))
+    {
+        // Mapping failed, fall back to mapping a segment every frame
+        glDeleteBuffers(1, &g_RingVboHandle);
+        glDeleteBuffers(1, &g_RingElementsHandle);
+        g_RingPersistent = false;
+        g_RingVboHandle = ImGui_ImplOpenGL3_CreateRingBuffer(vtx_segment * IMGUI_IMPL_OPENGL_RING_FRAMES, &g_RingVtxMapped);
+        g_RingElementsHandle = ImGui_ImplOpenGL3_CreateRingBuffer(idx_segment * IMGUI_IMPL_OPENGL_RING_FRAMES, &g_RingIdxMapped);
+    }
+    g_RingVtxSegmentSize = vtx_segment;
+    g_RingIdxSegmentSize = idx_segment;
+}
+
+static char* ImGui_ImplOpenGL3_MapRingSegment(GLuint handle, char* mapped, size_t offset, size_t size)
+{
+    if (mapped)
+        return mapped + offset;
+    // The fence already told us the GPU is done with this segment, so no need for the driver to synchronize
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle);
+    return (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+static void ImGui_ImplOpenGL3_UnmapRingSegment(GLuint handle, char* mapped)
+{
+    if (mapped)
+        return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, handle);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+}
+
+// Copy every draw list of the frame into the next ring segment. Returns false if the buffers couldn't be mapped,
+// in which case the caller uploads per draw list as usual.
+static bool ImGui_ImplOpenGL3_UploadRingFrame(ImDrawData* draw_data, size_t* out_vtx_offset, size_t* out_idx_offset)
+{
+    size_t vtx_size = (size_t)draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    size_t idx_size = (size_t)draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    if (!g_RingVboHandle || vtx_size > g_RingVtxSegmentSize || idx_size > g_RingIdxSegmentSize)
+        ImGui_ImplOpenGL3_CreateRingBuffers(vtx_size, idx_size);
+
+    // Normally signaled long ago, only waits if the GPU is more than RING_FRAMES frames behind
+    int frame = g_RingFrame;
+    if (g_RingFences[frame])
+    {
+        glClientWaitSync(g_RingFences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+        glDeleteSync(g_RingFences[frame]);
+        g_RingFences[frame] = 0;
+    }
+
+    size_t vtx_offset = (size_t)frame * g_RingVtxSegmentSize;
+    size_t idx_offset = (size_t)frame * g_RingIdxSegmentSize;
+    char* vtx_dst = ImGui_ImplOpenGL3_MapRingSegment(g_RingVboHandle, g_RingVtxMapped, vtx_offset, vtx_size);
+    char* idx_dst = ImGui_ImplOpenGL3_MapRingSegment(g_RingElementsHandle, g_RingIdxMapped, idx_offset, idx_size);
+    if (vtx_dst && idx_dst)
+    {
+        for (int n = 0; n < draw_data->CmdListsCount; n++)
+        {
+            const ImDrawList* cmd_list = draw_data->CmdLists[n];
+            memcpy(vtx_dst, cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+            memcpy(idx_dst, cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+            vtx_dst += (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+            idx_dst += (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        }
+    }
+    if (vtx_dst) ImGui_ImplOpenGL3_UnmapRingSegment(g_RingVboHandle, g_RingVtxMapped);
+    if (idx_dst) ImGui_ImplOpenGL3_UnmapRingSegment(g_RingElementsHandle, g_RingIdxMapped);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    *out_vtx_offset = vtx_offset;
+    *out_idx_offset = idx_offset;
+    return vtx_dst && idx_dst;
+}
+#endif
+
 void    ImGui_ImplOpenGL3_Shutdown()
 {
     ImGui_ImplOpenGL3_DestroyDeviceObjects();
@@ -226,6 +384,23 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
     glGenVertexArrays(1, &vao_handle);
     glBindVertexArray(vao_handle);
 #endif
+
+    // With the ring buffer the whole frame is uploaded once up front, and each draw list is drawn from its offset in
+    // the frame's segment. Otherwise each list re-specifies the stream buffers below.
+    bool use_ring = false;
+    size_t ring_vtx_offset = 0, ring_idx_offset = 0;
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+    if (g_RingEnabled)
+        use_ring = ImGui_ImplOpenGL3_UploadRingFrame(draw_data, &ring_vtx_offset, &ring_idx_offset);
+    else if (g_RingVboHandle)
+        ImGui_ImplOpenGL3_DestroyRingBuffers();
+    if (use_ring)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, g_RingVboHandle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_RingElementsHandle);
+    }
+    else
+#endif
     glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
     glEnableVertexAttribArray(g_AttribLocationPosition);
     glEnableVertexAttribArray(g_AttribLocationUV);
@@ -239,16 +414,20 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
 
     // Render command lists
+    GLint base_vertex = (GLint)(ring_vtx_offset / sizeof(ImDrawVert));
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        size_t idx_buffer_offset = 0;
+        size_t idx_buffer_offset = ring_idx_offset;
 
-        glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+        if (!use_ring)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
@@ -277,12 +456,30 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 
                     // Bind texture, Draw
                     glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->TextureId);
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+                    if (use_ring)
+                        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)idx_buffer_offset, base_vertex);
+                    else
+#endif
                     glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)idx_buffer_offset);
                 }
             }
             idx_buffer_offset += pcmd->ElemCount * sizeof(ImDrawIdx);
         }
+
+        if (use_ring)
+        {
+            base_vertex += cmd_list->VtxBuffer.Size;
+            ring_idx_offset += (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        }
     }
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+    if (use_ring)
+    {
+        g_RingFences[g_RingFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        g_RingFrame = (g_RingFrame + 1) % IMGUI_IMPL_OPENGL_RING_FRAMES;
+    }
+#endif
 #ifndef IMGUI_IMPL_OPENGL_ES2
     glDeleteVertexArrays(1, &vao_handle);
 #endif
@@ -572,6 +769,9 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
     if (g_VboHandle) glDeleteBuffers(1, &g_VboHandle);
     if (g_ElementsHandle) glDeleteBuffers(1, &g_ElementsHandle);
     g_VboHandle = g_ElementsHandle = 0;
+#ifdef IMGUI_IMPL_OPENGL_HAS_RING_BUFFER
+    ImGui_ImplOpenGL3_DestroyRingBuffers();
+#endif
 
     if (g_ShaderHandle && g_VertHandle) glDetachShader(g_ShaderHandle, g_VertHandle);
     if (g_VertHandle) glDeleteShader(g_VertHandle);
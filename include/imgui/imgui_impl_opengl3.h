@@ -39,6 +39,10 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_Shutdown();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_NewFrame();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data);
 
+// Stream all draw lists of a frame through one ring-buffered VBO/IBO (persistently mapped when GL 4.4 is available)
+// instead of re-specifying buffer storage twice per draw list. Desktop GL 3.2+ only, ignored elsewhere.
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetRingBuffer(bool enabled);
+
 // Called by Init/NewFrame/Shutdown
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
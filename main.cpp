@@ -9,245 +9,4340 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+// shaders and the font atlas, generated by tools/bake_assets at build time
+#include "assets.h"
+
+// offscreen rendering goes through EGL, which on Linux runs without a display
+// server and, with Mesa, without a GPU
+#if defined(__linux__)
+#define CONWAY_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// hardware counters around the step, Linux only
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
 
 const int MAX_INFO_LOG = 512;
 
-struct Game
+// below INSTANCED_ENTER_DENSITY live cells per cell it is cheaper to upload one
+// quad per live cell than the whole texture; the gap to INSTANCED_LEAVE_DENSITY
+// keeps a pattern hovering around the threshold from flipping modes every frame
+const float INSTANCED_ENTER_DENSITY = 1.0f / 16.0f;
+const float INSTANCED_LEAVE_DENSITY = 1.0f / 12.0f;
+
+// the renderer asks the engine for whole tiles, so small camera moves don't
+// change the size of what gets read back and uploaded
+const int TILE_SIZE = 64;
+
+const float MIN_ZOOM = 1.0f / 16.0f;
+const float MAX_ZOOM = 64.0f;
+// below this many pixels per cell there is no grid, same as in fragment.glsl
+const float GRID_MIN_CELL_SIZE = 4.0f;
+
+// when idle, frames keep being drawn this long after the last event so ImGui
+// can finish hover and other small animations, then the loop sleeps in
+// glfwWaitEventsTimeout until something arrives or the timeout passes
+const int IDLE_FRAMES = 4;
+const double IDLE_TIMEOUT = 1.0;
+
+enum RenderMode
+{
+    RENDER_AUTO,
+    RENDER_TEXTURE,
+    RENDER_INSTANCED,
+    RENDER_CPU,
+};
+
+// rows per task when shading frames on the CPU
+const int CPU_BAND_ROWS = 32;
+
+enum GpuPass
+{
+    GPU_PASS_UPLOAD,
+    GPU_PASS_CELLS,
+    GPU_PASS_OVERLAY,
+    GPU_PASS_IMGUI,
+    GPU_PASS_COUNT,
+};
+
+static char const *const GPU_PASS_NAMES[GPU_PASS_COUNT] = {"upload", "cells", "overlay", "imgui"};
+
+// timer results are read this many frames after they were recorded, by which
+// time the GPU has normally finished with them, so reading never stalls
+const int GPU_TIMER_FRAMES = 4;
+
+// CPU profiling zones, see Zone. Threads that can record at once, zones kept
+// per thread before the oldest are overwritten (a power of two), and frames of
+// history in the profiler window
+const int PROFILE_THREADS = 32;
+const int PROFILE_EVENTS = 4096;
+const int PROFILE_FRAMES = 240;
+
+// frame time histograms: log spaced buckets, HISTOGRAM_PER_OCTAVE to each
+// doubling from HISTOGRAM_MIN_MS up to about a second, over the last
+// HISTOGRAM_SAMPLES frames
+const int HISTOGRAM_BUCKETS = 48;
+const int HISTOGRAM_PER_OCTAVE = 4;
+const float HISTOGRAM_MIN_MS = 0.25f;
+const int HISTOGRAM_SAMPLES = 600;
+
+// how often --metrics is rewritten, in seconds
+const double METRICS_INTERVAL = 1.0;
+
+// what tracked allocations are counted against, see TrackedAllocator
+enum MemorySubsystem
+{
+    MEMORY_UNIVERSE,
+    MEMORY_RENDER,
+    MEMORY_CAPTURE,
+    MEMORY_PROFILER,
+    MEMORY_UI,
+    MEMORY_SUBSYSTEMS
+};
+
+static char const *const MEMORY_SUBSYSTEM_NAMES[MEMORY_SUBSYSTEMS] = {"universe", "render", "capture", "profiler", "ui"};
+
+enum PerfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTERS
+};
+
+// bytes brought in from memory per last level cache miss, for a rough bandwidth
+const int CACHE_LINE = 64;
+
+enum ColorMode
+{
+    COLOR_PLAIN,
+    COLOR_AGE,
+    COLOR_TRAIL,
+};
+
+enum ScheduleMode
+{
+    SCHEDULE_FRAME,     // one generation per frame
+    SCHEDULE_BUDGET,    // up to the target rate, as long as the steps fit in the budget
+    SCHEDULE_TURBO,     // fill the budget every frame and only draw every Nth one
+};
+
+// weight of the newest frame in the running step cost
+const float STEP_COST_SMOOTHING = 0.1f;
+// seconds between updates of the measured generation rate
+const double RATE_INTERVAL = 0.5;
+
+// a threaded step splits the rows into this many bands per thread, so a slow
+// band doesn't leave the other threads idle for long
+const int STEP_BANDS_PER_THREAD = 4;
+
+// planes at least this big get their own mapping, backed by transparent huge pages
+const size_t HUGE_PAGE = 2 << 20;
+// workers are pinned and bands handed out over at most this many NUMA nodes
+const int MAX_NUMA_NODES = 16;
+
+// 16 cells at a time, GCC/Clang vector extensions compile this to SSE2 or NEON
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+
+// bytes each subsystem holds now and at most, kept up to date by every allocation
+struct MemoryCounter
+{
+    std::atomic<int64_t> live;
+    std::atomic<int64_t> peak;
+};
+
+MemoryCounter memory_counters[MEMORY_SUBSYSTEMS];
+
+void track_memory(int subsystem, int64_t bytes)
+{
+    MemoryCounter &counter = memory_counters[subsystem];
+    int64_t live = counter.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = counter.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+// std::allocator, counting what it hands out against a subsystem
+template <typename T, int Subsystem>
+struct TrackedAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef TrackedAllocator<U, Subsystem> other;
+    };
+
+    TrackedAllocator() {}
+    template <typename U>
+    TrackedAllocator(TrackedAllocator<U, Subsystem> const &) {}
+
+    T *allocate(size_t count)
+    {
+        track_memory(Subsystem, (int64_t)(count * sizeof(T)));
+        return (T *)::operator new(count * sizeof(T));
+    }
+
+    void deallocate(T *p, size_t count)
+    {
+        track_memory(Subsystem, -(int64_t)(count * sizeof(T)));
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(TrackedAllocator<U, Subsystem> const &) const { return true; }
+    template <typename U>
+    bool operator!=(TrackedAllocator<U, Subsystem> const &) const { return false; }
+};
+
+template <typename T, int Subsystem>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Subsystem>>;
+
+// a 2 MB aligned mapping marked for huge pages. The kernel hands it out zeroed
+// and PlaneAllocator doesn't write it, so each page lands on the NUMA node of
+// whoever writes it first. Headless runs and the bench have touch_universe do
+// that from the pool that steps them
+void *map_plane(size_t bytes)
+{
+    size_t size = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+    char *base = (char *)mmap(NULL, size + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        throw std::bad_alloc();
+
+    char *aligned = (char *)(((uintptr_t)base + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+    if (aligned > base)
+        munmap(base, aligned - base);
+    if (base + HUGE_PAGE > aligned)
+        munmap(aligned + size, base + HUGE_PAGE - aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+void unmap_plane(void *p, size_t bytes)
+{
+    munmap(p, (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+}
+
+// TrackedAllocator for the universe planes. Big planes are mapped, see
+// map_plane, small ones zeroed by hand, and elements grown into are left as
+// they are, so a fresh plane reads as all dead without anything touching it
+template <typename T>
+struct PlaneAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef PlaneAllocator<U> other;
+    };
+
+    PlaneAllocator() {}
+    template <typename U>
+    PlaneAllocator(PlaneAllocator<U> const &) {}
+
+    T *allocate(size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        track_memory(MEMORY_UNIVERSE, (int64_t)bytes);
+        if (bytes >= HUGE_PAGE)
+            return (T *)map_plane(bytes);
+        return (T *)memset(::operator new(bytes), 0, bytes);
+    }
+
+    void deallocate(T *p, size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        track_memory(MEMORY_UNIVERSE, -(int64_t)bytes);
+        if (bytes >= HUGE_PAGE)
+            unmap_plane(p, bytes);
+        else
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    void construct(U *) {}
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&... args) { new (p) U(std::forward<Args>(args)...); }
+
+    template <typename U>
+    bool operator==(PlaneAllocator<U> const &) const { return true; }
+    template <typename U>
+    bool operator!=(PlaneAllocator<U> const &) const { return false; }
+};
+
+typedef std::vector<uint8_t, PlaneAllocator<uint8_t>> Plane;
+typedef TrackedVector<uint8_t, MEMORY_CAPTURE> FrameBytes;
+
+struct Universe
+{
+    int width;
+    int height;
+
+    // one byte per cell, 0 = dead, 1 = alive
+    Plane cells;
+    Plane next;
+
+    // live cells count generations alive, saturating at 255. When a cell dies
+    // its age jumps to 255 and loses decay per generation, so with decay < 255
+    // dead cells leave a fading trail
+    Plane age;
+    uint8_t decay;
+
+    uint64_t generation;
+    size_t population;
+
+    // the last step changed neither cells nor ages, so stepping again would
+    // give the same universe
+    bool settled;
+};
+
+// a rectangle of cells, in universe coordinates
+struct Region
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// where a step should also write display texels, (alive, age) byte pairs for
+// each cell of region, row by row
+struct Texels
+{
+    Region region;
+    uint8_t *data;
+
+    // cells written with a non-zero age
+    size_t visible;
+};
+
+struct Camera
+{
+    // cell coordinate at the center of the screen
+    double x;
+    double y;
+
+    // pixels per cell
+    float zoom;
+
+    bool dragging;
+    double drag_x;
+    double drag_y;
+};
+
+struct Selection
+{
+    bool active;
+    bool selecting;
+
+    // corners in cells, inclusive, in the order they were dragged out
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+struct GpuTimers
+{
+    unsigned int queries[GPU_TIMER_FRAMES][GPU_PASS_COUNT];
+    // recorded but not read back yet
+    bool pending[GPU_TIMER_FRAMES][GPU_PASS_COUNT];
+    // ring slot recording this frame
+    int frame;
+    // pass being timed, GL_TIME_ELAPSED queries can't nest
+    int active;
+
+    // smoothed milliseconds per pass
+    float ms[GPU_PASS_COUNT];
+};
+
+// how many generations each frame runs
+struct Scheduler
+{
+    int mode;
+    float budget_ms;
+    // generations per second in budget mode, 0 = as many as fit in the budget
+    float target_rate;
+    int present_every;
+
+    // running average milliseconds per generation
+    float step_ms;
+    int batch;
+    // turbo frames stepped since the last one drawn
+    int skipped;
+
+    // measured generations per second
+    uint64_t steps;
+    uint64_t rate_steps;
+    double rate_time;
+    float rate;
+};
+
+// frames read back into pixel pack buffers, mapped once their fence has
+// signalled, by which time the copy is done and mapping doesn't stall
+const int CAPTURE_FRAMES = 3;
+// frames handed to the writer but not written yet, capturing waits beyond this
+const int CAPTURE_QUEUE = 8;
+// frame rate written into y4m headers
+const int CAPTURE_FPS = 60;
+
+struct CaptureSlot
+{
+    unsigned int pbo;
+    size_t size;
+    GLsync fence;
+    int width;
+    int height;
+    // a ppm written on its own, or empty for the next frame of the y4m stream
+    std::string filename;
+};
+
+// RGBA rows bottom to top, as GL reads them
+struct CaptureJob
+{
+    FrameBytes pixels;
+    int width;
+    int height;
+    std::string filename;
+};
+
+struct Capture
+{
+    CaptureSlot slots[CAPTURE_FRAMES];
+    // oldest slot still waiting for its fence, and how many are waiting
+    int first;
+    int in_flight;
+
+    // y4m recording, the size is fixed by the first frame
+    bool recording;
+    std::ofstream stream;
+    int stream_width;
+    int stream_height;
+
+    // the writer thread encodes and writes while the main thread carries on
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<CaptureJob> jobs;
+    bool writing;
+    bool quit;
+    // a frame or the recording failed to write, set with the mutex held
+    bool failed;
+
+    // screenshot asked for from the UI, taken with the next frame
+    bool screenshot;
+};
+
+struct Options
+{
+    // no GL at all, just step the universe
+    bool headless;
+    // render through an offscreen GL context instead of a window
+    bool offscreen;
+
+    int width;
+    int height;
+    float density;
+    unsigned int seed;
+
+    // stop after this many generations, 0 = run until the window closes
+    uint64_t generations;
+    // report, and with out render a frame, every this many generations
+    uint64_t every;
+    // PPM frame output, a printf pattern taking the generation if it contains %,
+    // or a .y4m video, - for a headless video on stdout
+    char const *out;
+    // worker threads, 0 = one per core
+    int threads;
+
+    // Prometheus text metrics, rewritten every METRICS_INTERVAL
+    char const *metrics;
+
+    // step every engine side by side and stop at the first difference
+    bool crosscheck;
+
+    // run the engine benchmarks and print JSON, on universes up to this size
+    bool bench;
+    int bench_max;
+    double bench_seconds;
+};
+
+// workers running queued tasks, finished is signalled after every task
+struct ThreadPool
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::deque<std::function<void()>> tasks;
+    int busy;
+    bool quit;
+    // NUMA nodes the workers are pinned across, 0 or 1 when they aren't
+    int nodes;
+};
+
+// what the texture pass shows, enough to shade a frame on the CPU: the texel
+// column and row under each pixel, -1 outside the region, and the color of
+// every alive, age pair
+struct RasterView
+{
+    int width;
+    int height;
+    Region region;
+    TrackedVector<int, MEMORY_RENDER> columns;
+    TrackedVector<int, MEMORY_RENDER> rows;
+    uint32_t colors[2][256];
+};
+
+// one frame of a headless video, shaded on the pool while the universe moves on
+struct VideoFrame
+{
+    FrameBytes texels;
+    FrameBytes yuv;
+    // set by the worker outside the pool's lock
+    std::atomic<bool> done;
+};
+
+// a finished zone, in read_ticks ticks
+struct ZoneEvent
+{
+    char const *name;
+    uint64_t start;
+    uint64_t end;
+    int depth;
+};
+
+// one thread's finished zones. Only the owning thread writes, bumping head
+// after each event, so recording takes no lock. Readers copy events and drop
+// any that head lapped while they were copying
+struct ZoneBuffer
+{
+    ZoneEvent events[PROFILE_EVENTS];
+    std::atomic<uint64_t> head;
+    std::atomic<bool> owned;
+    int depth;
+    char name[32];
+};
+
+// buffers are claimed by threads the first time they record and given back
+// when they exit, never freed. Ticks are calibrated against the steady clock
+// from when the first one was claimed
+struct ZoneRegistry
+{
+    std::atomic<ZoneBuffer *> buffers[PROFILE_THREADS];
+    std::mutex mutex;
+    uint64_t base_ticks;
+    std::chrono::steady_clock::time_point base_time;
+};
+
+struct ProfileSpan
+{
+    char const *name;
+    uint64_t start;
+    uint64_t end;
+    int depth;
+    int thread;
+};
+
+// the zones every thread finished during a frame
+struct ProfileFrame
+{
+    uint64_t start;
+    uint64_t end;
+    TrackedVector<ProfileSpan, MEMORY_PROFILER> spans;
+};
+
+struct Profile
+{
+    // ring of the last PROFILE_FRAMES frames, next is written at the end of this one
+    TrackedVector<ProfileFrame, MEMORY_PROFILER> frames;
+    int next;
+    int count;
+    uint64_t frame_start;
+    // how far each buffer has been read, and which one is the main thread's
+    uint64_t read[PROFILE_THREADS];
+    int main_thread;
+    TrackedVector<ZoneEvent, MEMORY_PROFILER> events;
+    double ticks_per_ms;
+
+    // stop collecting to look at what's there. The flame graph shows the
+    // selected slot, or the slowest frame when it's -1
+    bool frozen;
+    int selected;
+};
+
+struct Histogram
+{
+    // ring of the last HISTOGRAM_SAMPLES milliseconds, and bucket counts over them
+    float samples[HISTOGRAM_SAMPLES];
+    int next;
+    int count;
+    int buckets[HISTOGRAM_BUCKETS];
+    // every sample since start, the _count and _sum of the exported summary
+    uint64_t total;
+    double total_ms;
+};
+
+struct PerfCounters
+{
+    int fds[PERF_COUNTERS];
+    bool open;
+    // counts per generation over the steps of the last few frames, smoothed like step_ms
+    float per_generation[PERF_COUNTERS];
+};
+
+struct Game
+{
+    unsigned int shaderProgram;
+    unsigned int VAO;
+    unsigned int color_location;
+
+    struct {
+        int mode;
+        int viewport;
+        int view_origin;
+        int cell_size;
+        int region;
+        int cells;
+        int universe_size;
+        int hover;
+        int selection;
+        int color_mode;
+        int palette;
+    } uniforms;
+
+    GLFWwindow *window;
+
+    Options options;
+
+#ifdef CONWAY_EGL
+    struct {
+        EGLDisplay display;
+        EGLContext context;
+    } egl;
+#endif
+    // render target when there is no window
+    unsigned int fbo;
+    unsigned int fbo_color;
+
+    float accum_time;
+
+    Universe universe;
+    bool paused;
+    float seed_density;
+
+    // sleep instead of redrawing while nothing changes, redraw counts down
+    // the frames still to draw
+    bool idle;
+    int redraw;
+
+    Scheduler schedule;
+    PerfCounters perf;
+
+    // when metrics were last written, and the generation then
+    double metrics_time;
+    uint64_t metrics_generation;
+
+    Camera camera;
+    Selection selection;
+
+    // cell under the cursor, only valid while hovering
+    bool hovering;
+    int hover_x;
+    int hover_y;
+
+    struct {
+        int mode;
+        bool instanced;
+        int color_mode;
+        int trail_length;
+
+        // live cells per cell in what was drawn last frame
+        float density;
+        Region region;
+
+        unsigned int texture;
+        int texture_width;
+        int texture_height;
+        TrackedVector<uint8_t, MEMORY_RENDER> staging;
+
+        unsigned int palette;
+
+        // the step writes this frame's texels straight into a mapped pixel
+        // unpack buffer instead of the renderer reading the grid back afterwards
+        bool fused;
+        bool fused_ready;
+        unsigned int pbo;
+        Texels texels;
+
+        unsigned int instance_vao;
+        unsigned int instance_vbo;
+        TrackedVector<int32_t, MEMORY_RENDER> instances;
+
+        // the CPU renderer shades the whole frame on the pool and uploads it as
+        // one RGBA texture, for machines where fragment shading is the slow part.
+        // staged says the fused step already left this frame's texels in staging
+        bool staged;
+        RasterView view;
+        TrackedVector<uint32_t, MEMORY_RENDER> pixels;
+        unsigned int frame_texture;
+        unsigned int frame_fbo;
+        int frame_width;
+        int frame_height;
+
+        // imgui vertices go through one ring buffer instead of two uploads per draw list
+        bool imgui_ring;
+    } render;
+
+    GpuTimers gpu;
+    Profile profile;
+    Capture capture;
+    ThreadPool pool;
+
+    struct {
+        float previous;
+        float now;
+        float delta;
+
+        // when the frame read input and when the last one was presented, and
+        // the display's refresh period
+        double input;
+        double presented;
+        double refresh;
+    } time;
+
+    // time between presented frames, stepping per frame, and input to photon
+    struct {
+        Histogram frame;
+        Histogram step;
+        Histogram latency;
+    } histograms;
+
+    int X;
+    int Y;
+
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+// keeps the main loop drawing for a few more frames, see IDLE_FRAMES
+void wake(GLFWwindow *window)
+{
+    Game *game = (Game *)glfwGetWindowUserPointer(window);
+    if (game)
+        game->redraw = IDLE_FRAMES;
+}
+
+void framebuffer_size_callback(GLFWwindow *window, int width, int height)
+{
+    glViewport(0, 0, width, height);
+    wake(window);
+}
+
+void window_refresh_callback(GLFWwindow *window)
+{
+    wake(window);
+}
+
+void framebuffer_size(Game &game, int &width, int &height)
+{
+    if (game.window)
+    {
+        glfwGetFramebufferSize(game.window, &width, &height);
+        return;
+    }
+    width = game.X;
+    height = game.Y;
+}
+
+int file_length(std::ifstream &file)
+{
+    file.seekg(0, file.end);
+    int length = file.tellg();
+    file.seekg(0, file.beg);
+    return length;
+}
+
+// returns 0 when the shader doesn't compile, GL never uses 0 as a shader name
+unsigned int load_shader(Game &game, std::string const &source, unsigned int shader_type)
+{
+    char const *text = source.c_str();
+    int length = (int)source.size();
+
+    unsigned int shader;
+    shader = glCreateShader(shader_type);
+    glShaderSource(shader, 1, &text, &length);
+    glCompileShader(shader);
+
+    int success;
+    char infoLog[MAX_INFO_LOG];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, MAX_INFO_LOG, NULL, infoLog);
+        std::cout << (shader_type == GL_VERTEX_SHADER ? "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" : "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n")
+                  << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+uint64_t fnv1a(uint64_t hash, char const *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// linked programs are cached on disk by a hash of the shader sources and of the
+// driver that compiled them, a new driver or an edited shader just misses
+const uint32_t PROGRAM_CACHE_MAGIC = 0x79776e63; // "cnwy"
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+};
+
+uint64_t program_cache_key(std::string const &vertex, std::string const &fragment)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, vertex.c_str(), vertex.size() + 1);
+    hash = fnv1a(hash, fragment.c_str(), fragment.size() + 1);
+    GLenum const names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names)
+    {
+        char const *value = (char const *)glGetString(name);
+        if (value)
+            hash = fnv1a(hash, value, strlen(value) + 1);
+    }
+    return hash;
+}
+
+// $XDG_CACHE_HOME/conway or ~/.cache/conway, created on the way. Empty when
+// there is nowhere to put it
+std::string program_cache_dir()
+{
+    std::string dir;
+    if (char const *cache = getenv("XDG_CACHE_HOME"))
+        dir = cache;
+    else if (char const *home = getenv("HOME"))
+        dir = std::string(home) + "/.cache";
+    else
+        return "";
+
+    mkdir(dir.c_str(), 0755);
+    dir += "/conway";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        return "";
+    return dir;
+}
+
+std::string program_cache_path(uint64_t key)
+{
+    std::string dir = program_cache_dir();
+    if (dir.empty())
+        return "";
+
+    char name[32];
+    snprintf(name, sizeof(name), "/program-%016llx.bin", (unsigned long long)key);
+    return dir + name;
+}
+
+// program binaries need GL 4.1 and a driver that offers at least one format,
+// macOS reports none. The bundled glad doesn't load ARB_get_program_binary, so
+// older contexts that have the extension go without
+bool program_binary_supported()
+{
+    if (!GLAD_GL_VERSION_4_1 || !glProgramBinary || !glGetProgramBinary)
+        return false;
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// links program from the cached binary, false on any mismatch so the caller
+// compiles instead
+bool load_program_binary(unsigned int program, std::string const &path, uint64_t key)
+{
+    std::string data;
+    std::ifstream file(path.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!file)
+        return false;
+    data.resize(file_length(file));
+    file.read(&data[0], data.size());
+    if (!file || data.size() <= sizeof(ProgramCacheHeader))
+        return false;
+
+    ProgramCacheHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != PROGRAM_CACHE_MAGIC || header.key != key)
+        return false;
+
+    glProgramBinary(program, header.format, data.data() + sizeof(header), (int)(data.size() - sizeof(header)));
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success;
+}
+
+// written to a temporary file and renamed, so another instance starting at the
+// same time never reads half a binary
+void save_program_binary(unsigned int program, std::string const &path, uint64_t key)
+{
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ProgramCacheHeader header = {PROGRAM_CACHE_MAGIC, 0, key};
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &length, &header.format, binary.data());
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    file.write((char const *)&header, sizeof(header));
+    file.write(binary.data(), length);
+    file.close();
+    if (!file || rename(temporary.c_str(), path.c_str()) != 0)
+        remove(temporary.c_str());
+}
+
+int compile_program(Game &game, std::string const &vertex, std::string const &fragment)
+{
+    // create shaders
+    unsigned int vertex_shader = load_shader(game, vertex, GL_VERTEX_SHADER);
+    if (vertex_shader == 0)
+        return -1;
+
+    unsigned int fragment_shader = load_shader(game, fragment, GL_FRAGMENT_SHADER);
+    if (fragment_shader == 0)
+    {
+        glDeleteShader(vertex_shader);
+        return -1;
+    }
+
+    glAttachShader(game.shaderProgram, vertex_shader);
+    glAttachShader(game.shaderProgram, fragment_shader);
+    glLinkProgram(game.shaderProgram);
+
+    // delete shaders once they are linked, we don't need them anymore
+    glDetachShader(game.shaderProgram, vertex_shader);
+    glDetachShader(game.shaderProgram, fragment_shader);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    int success;
+    char infoLog[MAX_INFO_LOG];
+    glGetProgramiv(game.shaderProgram, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(game.shaderProgram, MAX_INFO_LOG, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
+                  << infoLog << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int setup_shaders(Game &game)
+{
+    std::string vertex(VERTEX_SHADER_SOURCE);
+    std::string fragment(FRAGMENT_SHADER_SOURCE);
+
+    game.shaderProgram = glCreateProgram();
+
+    std::string cache_path;
+    uint64_t key = 0;
+    if (program_binary_supported())
+    {
+        key = program_cache_key(vertex, fragment);
+        cache_path = program_cache_path(key);
+    }
+
+    if (cache_path.empty() || !load_program_binary(game.shaderProgram, cache_path, key))
+    {
+        if (!cache_path.empty())
+            glProgramParameteri(game.shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        if (compile_program(game, vertex, fragment) < 0)
+            return -1;
+
+        if (!cache_path.empty())
+            save_program_binary(game.shaderProgram, cache_path, key);
+    }
+
+    game.color_location = glGetUniformLocation(game.shaderProgram, "ourColor");
+    game.uniforms.mode = glGetUniformLocation(game.shaderProgram, "mode");
+    game.uniforms.viewport = glGetUniformLocation(game.shaderProgram, "viewport");
+    game.uniforms.view_origin = glGetUniformLocation(game.shaderProgram, "view_origin");
+    game.uniforms.cell_size = glGetUniformLocation(game.shaderProgram, "cell_size");
+    game.uniforms.region = glGetUniformLocation(game.shaderProgram, "region");
+    game.uniforms.cells = glGetUniformLocation(game.shaderProgram, "cells");
+    game.uniforms.universe_size = glGetUniformLocation(game.shaderProgram, "universe_size");
+    game.uniforms.hover = glGetUniformLocation(game.shaderProgram, "hover");
+    game.uniforms.selection = glGetUniformLocation(game.shaderProgram, "selection");
+    game.uniforms.color_mode = glGetUniformLocation(game.shaderProgram, "color_mode");
+    game.uniforms.palette = glGetUniformLocation(game.shaderProgram, "palette");
+
+    return 0;
+}
+
+int init_gl(Game &game)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+    game.window = glfwCreateWindow(game.X, game.Y, "conway", NULL, NULL);
+    if (game.window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(game.window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    glfwSetFramebufferSizeCallback(game.window, framebuffer_size_callback);
+
+    glViewport(0, 0, game.X, game.Y);
+
+    // this is a stupid workaround around a bug in Mojave. Figure out why this sucks'
+    // https://stackoverflow.com/questions/52509427/mac-mojave-opengl
+    glfwSetWindowSize(game.window, game.X - 1, game.Y);
+    glfwPollEvents();
+    glfwSetWindowSize(game.window, game.X, game.Y);
+
+    return 0;
+}
+
+void init_universe(Universe &universe, int width, int height)
+{
+    universe.width = width;
+    universe.height = height;
+    // the old planes go first, new ones come back zeroed and untouched
+    size_t size = (size_t)width * height;
+    universe.cells = Plane();
+    universe.next = Plane();
+    universe.age = Plane();
+    universe.cells.resize(size);
+    universe.next.resize(size);
+    universe.age.resize(size);
+    universe.decay = 255;
+    universe.generation = 0;
+    universe.population = 0;
+    universe.settled = false;
+}
+
+void seed_universe(Universe &universe, float density, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution alive(density);
+
+    universe.population = 0;
+    for (size_t i = 0; i < universe.cells.size(); i++)
+    {
+        universe.cells[i] = alive(rng);
+        universe.age[i] = universe.cells[i];
+        universe.population += universe.cells[i];
+    }
+    universe.generation = 0;
+    universe.settled = false;
+}
+
+// a cycle counter where there is one: the TSC on x86, the virtual counter on
+// ARM. Only differences mean anything, see Profile.ticks_per_ms
+static inline uint64_t read_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+ZoneRegistry zones;
+
+// set by F12 or SIGUSR2, the running loop writes a trace when it sees it
+volatile sig_atomic_t trace_requested;
+
+void request_trace(int signal)
+{
+    trace_requested = 1;
+}
+
+// gives the thread's buffer back when it exits
+struct ZoneOwner
+{
+    ZoneBuffer *buffer;
+
+    ~ZoneOwner()
+    {
+        if (buffer)
+            buffer->owned.store(false, std::memory_order_release);
+    }
+};
+
+static thread_local ZoneOwner zone_owner;
+
+// the calling thread's buffer, claiming a free one the first time. NULL when
+// every buffer is taken, that thread's zones are then not recorded
+ZoneBuffer *thread_zones()
+{
+    if (zone_owner.buffer)
+        return zone_owner.buffer;
+
+    std::lock_guard<std::mutex> lock(zones.mutex);
+    for (int i = 0; i < PROFILE_THREADS; i++)
+    {
+        ZoneBuffer *buffer = zones.buffers[i].load(std::memory_order_acquire);
+        if (buffer && buffer->owned.load(std::memory_order_acquire))
+            continue;
+
+        if (i == 0 && !buffer)
+        {
+            zones.base_ticks = read_ticks();
+            zones.base_time = std::chrono::steady_clock::now();
+        }
+        if (!buffer)
+        {
+            buffer = new ZoneBuffer();
+            track_memory(MEMORY_PROFILER, sizeof(ZoneBuffer));
+        }
+        buffer->owned.store(true, std::memory_order_relaxed);
+        buffer->depth = 0;
+        snprintf(buffer->name, sizeof(buffer->name), "thread %d", i);
+        zones.buffers[i].store(buffer, std::memory_order_release);
+
+        zone_owner.buffer = buffer;
+        return buffer;
+    }
+    return NULL;
+}
+
+double zone_ticks_per_ms()
+{
+    if (!zones.buffers[0].load(std::memory_order_acquire))
+        return 0.0;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - zones.base_time).count();
+    return ms > 0.0 ? (read_ticks() - zones.base_ticks) / ms : 0.0;
+}
+
+void name_thread(char const *name)
+{
+    if (ZoneBuffer *buffer = thread_zones())
+        snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+// times the enclosing scope on the calling thread, { Zone zone("step"); ... }.
+// Names are told apart by address, so they must be string literals
+struct Zone
+{
+    ZoneBuffer *buffer;
+    char const *name;
+    uint64_t start;
+
+    Zone(char const *name) : buffer(thread_zones()), name(name), start(read_ticks())
+    {
+        if (buffer)
+            buffer->depth++;
+    }
+
+    ~Zone()
+    {
+        if (!buffer)
+            return;
+        int depth = --buffer->depth;
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        buffer->events[head & (PROFILE_EVENTS - 1)] = ZoneEvent{name, start, read_ticks(), depth};
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+};
+
+// appends the buffer's zones from index from on to out, leaving out any that
+// were overwritten before they could be copied. Returns where to read from next
+uint64_t copy_zones(ZoneBuffer const *buffer, uint64_t from, TrackedVector<ZoneEvent, MEMORY_PROFILER> &out)
+{
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    if (head > PROFILE_EVENTS)
+        from = std::max(from, head - PROFILE_EVENTS);
+
+    size_t first = out.size();
+    for (uint64_t i = from; i < head; i++)
+        out.push_back(buffer->events[i & (PROFILE_EVENTS - 1)]);
+
+    // the slot of event i is reused once the writer gets to i + PROFILE_EVENTS
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t now = buffer->head.load(std::memory_order_relaxed);
+    if (now + 1 > from + PROFILE_EVENTS)
+    {
+        size_t lost = std::min((size_t)(now + 1 - PROFILE_EVENTS - from), out.size() - first);
+        out.erase(out.begin() + first, out.begin() + first + lost);
+    }
+    return head;
+}
+
+// the frame starts here rather than where the last one ended, so time spent
+// asleep waiting for events doesn't show up as a slow frame
+void begin_profile_frame(Game &game)
+{
+    game.profile.frame_start = read_ticks();
+}
+
+// collects the zones every thread finished since the last frame
+void end_profile_frame(Game &game)
+{
+    Profile &profile = game.profile;
+    uint64_t now = read_ticks();
+    if (profile.frames.empty())
+        profile.frames.resize(PROFILE_FRAMES);
+    profile.ticks_per_ms = zone_ticks_per_ms();
+
+    ProfileFrame &frame = profile.frames[profile.next];
+    frame.start = profile.frame_start;
+    frame.end = now;
+    frame.spans.clear();
+    for (int i = 0; i < PROFILE_THREADS; i++)
+    {
+        // buffers are claimed in order and never removed
+        ZoneBuffer *buffer = zones.buffers[i].load(std::memory_order_acquire);
+        if (!buffer)
+            break;
+        if (buffer == zone_owner.buffer)
+            profile.main_thread = i;
+
+        // skip what happened while frozen rather than pile it onto the next frame
+        if (profile.frozen)
+        {
+            profile.read[i] = buffer->head.load(std::memory_order_acquire);
+            continue;
+        }
+
+        profile.events.clear();
+        profile.read[i] = copy_zones(buffer, profile.read[i], profile.events);
+        for (ZoneEvent const &event : profile.events)
+            frame.spans.push_back(ProfileSpan{event.name, event.start, event.end, event.depth, i});
+    }
+    if (profile.frozen)
+        return;
+
+    profile.next = (profile.next + 1) % PROFILE_FRAMES;
+    profile.count = std::min(profile.count + 1, PROFILE_FRAMES);
+}
+
+// opens the counters on the calling thread, user space only so they work with
+// perf_event_paranoid up to 2. With inherit threads started from now on count
+// too, but only add into what's read once they exit
+bool open_perf_counters(PerfCounters &perf, bool inherit)
+{
+    perf.open = false;
+#if defined(__linux__)
+    static const uint64_t configs[PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = inherit;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        perf.fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (perf.fds[i] < 0)
+        {
+            while (i-- > 0)
+                close(perf.fds[i]);
+            return false;
+        }
+    }
+    perf.open = true;
+#endif
+    return perf.open;
+}
+
+// counts so far, scaled up for the time the kernel had them multiplexed out
+void read_perf_counters(PerfCounters const &perf, uint64_t *counts)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        // value, time enabled, time running
+        uint64_t value[3];
+        counts[i] = 0;
+        if (perf.open && read(perf.fds[i], value, sizeof(value)) == sizeof(value) && value[2])
+            counts[i] = (uint64_t)(value[0] * ((double)value[1] / value[2]));
+    }
+}
+
+void close_perf_counters(PerfCounters &perf)
+{
+    if (!perf.open)
+        return;
+    for (int i = 0; i < PERF_COUNTERS; i++)
+        close(perf.fds[i]);
+    perf.open = false;
+}
+
+// the NUMA node the current pool worker is pinned to
+thread_local int worker_node = 0;
+
+// "0-3,8-11" as 0, 1, 2, 3, 8, 9, 10, 11
+std::vector<int> parse_cpu_list(std::string const &list)
+{
+    std::vector<int> cpus;
+    char const *p = list.c_str();
+    while (*p >= '0' && *p <= '9')
+    {
+        char *end;
+        int first = (int)strtol(p, &end, 10);
+        int last = first;
+        if (*end == '-')
+            last = (int)strtol(end + 1, &end, 10);
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+}
+
+// the cpus of each NUMA node that has any, empty without /sys
+std::vector<std::vector<int>> read_numa_nodes()
+{
+    std::vector<std::vector<int>> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!std::getline(online, list))
+        return nodes;
+
+    for (int node : parse_cpu_list(list))
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpus;
+        if (std::getline(file, cpus) && !parse_cpu_list(cpus).empty() && (int)nodes.size() < MAX_NUMA_NODES)
+            nodes.push_back(parse_cpu_list(cpus));
+    }
+    return nodes;
+}
+
+void pool_worker(ThreadPool *pool, int node)
+{
+    name_thread("worker");
+    worker_node = node;
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while (true)
+    {
+        pool->wake.wait(lock, [pool] { return pool->quit || !pool->tasks.empty(); });
+        if (pool->tasks.empty())
+            return;
+
+        std::function<void()> task = std::move(pool->tasks.front());
+        pool->tasks.pop_front();
+        pool->busy++;
+        lock.unlock();
+
+        task();
+
+        lock.lock();
+        pool->busy--;
+        pool->finished.notify_all();
+    }
+}
+
+// with pin and more than one NUMA node, workers are dealt round the nodes and
+// pinned to a cpu there. Worker i always gets the same cpu, so a pool started
+// again with as many threads finds the pages touch_universe placed
+void start_pool(ThreadPool &pool, int count, bool pin = false)
+{
+    if (count <= 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+    if (pin)
+        nodes = read_numa_nodes();
+#endif
+    // a node without workers would leave its bands to the others
+    pool.nodes = std::max(1, std::min((int)nodes.size(), count));
+
+    for (int i = 0; i < count; i++)
+    {
+        int node = i % pool.nodes;
+        pool.threads.emplace_back(pool_worker, &pool, node);
+#if defined(__linux__)
+        if (pool.nodes > 1)
+        {
+            std::vector<int> const &cpus = nodes[node];
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[(i / pool.nodes) % cpus.size()], &set);
+            pthread_setaffinity_np(pool.threads.back().native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+void pool_submit(ThreadPool &pool, std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.tasks.push_back(std::move(task));
+    }
+    pool.wake.notify_one();
+}
+
+// blocks until done() holds, checked with the pool locked after every task.
+// Anything tasks write before returning is visible to done() and after
+template <typename Done>
+void pool_wait(ThreadPool &pool, Done done)
+{
+    Zone zone("wait");
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    pool.finished.wait(lock, done);
+}
+
+void pool_wait_all(ThreadPool &pool)
+{
+    pool_wait(pool, [&pool] { return pool.tasks.empty() && pool.busy == 0; });
+}
+
+void stop_pool(ThreadPool &pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.quit = true;
+    }
+    pool.wake.notify_all();
+    for (std::thread &thread : pool.threads)
+        thread.join();
+    pool.threads.clear();
+    pool.quit = false;
+}
+
+static inline u8x16 load16(uint8_t const *p)
+{
+    u8x16 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store16(uint8_t *p, u8x16 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+// cells [x0, x1) of one row, one at a time, wrapping around at the edges.
+// changed is set when any cell or age differs from before
+static size_t step_cells(uint8_t const *up, uint8_t const *row, uint8_t const *down,
+                         uint8_t *out, uint8_t *age, int x0, int x1, int w, uint8_t decay, bool &changed)
+{
+    size_t population = 0;
+    for (int x = x0; x < x1; x++)
+    {
+        int l = x == 0 ? w - 1 : x - 1;
+        int r = x == w - 1 ? 0 : x + 1;
+        int n = up[l] + up[x] + up[r] + row[l] + row[r] + down[l] + down[x] + down[r];
+        uint8_t alive = n == 3 || (n == 2 && row[x]);
+
+        int a = age[x];
+        if (alive)
+            a = row[x] ? std::min(a + 1, 255) : 1;
+        else
+            a = std::max((row[x] ? 255 : a) - decay, 0);
+
+        changed |= alive != row[x] || a != age[x];
+        out[x] = alive;
+        age[x] = (uint8_t)a;
+        population += alive;
+    }
+    return population;
+}
+
+// one row of the next generation and its ages, 16 cells at a time between the
+// edge columns. Same rules as step_cells, written as masks so there are no branches
+static size_t step_row(uint8_t const *up, uint8_t const *row, uint8_t const *down,
+                       uint8_t *out, uint8_t *age, int w, uint8_t decay, bool &changed)
+{
+    size_t population = step_cells(up, row, down, out, age, 0, 1, w, decay, changed);
+
+    // nonzero lanes wherever a cell or an age changed
+    u8x16 diff = {};
+
+    // live counts are accumulated per lane and flushed before a lane can overflow
+    u8x16 count = {};
+    int pending = 0;
+
+    int x = 1;
+    for (; x + 16 <= w - 1; x += 16)
+    {
+        u8x16 c = load16(row + x);
+        u8x16 n = load16(up + x - 1) + load16(up + x) + load16(up + x + 1)
+                + load16(row + x - 1) + load16(row + x + 1)
+                + load16(down + x - 1) + load16(down + x) + load16(down + x + 1);
+
+        // 0xff where the cell is alive in the next / this generation
+        u8x16 alive = (u8x16)((n == 3) | ((n == 2) & (c != 0)));
+        u8x16 was = -c;
+
+        u8x16 a = load16(age + x);
+        u8x16 grown = a & was;
+        grown -= (u8x16)(grown != 255);
+        u8x16 fading = a | was;
+        fading = (fading - decay) & (u8x16)(fading > decay);
+        u8x16 aged = (alive & grown) | (~alive & fading);
+        store16(age + x, aged);
+
+        alive &= 1;
+        store16(out + x, alive);
+        diff |= (aged ^ a) | (alive ^ c);
+
+        count += alive;
+        if (++pending == 255)
+        {
+            for (int i = 0; i < 16; i++)
+                population += count[i];
+            count = u8x16{};
+            pending = 0;
+        }
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        population += count[i];
+        changed |= diff[i] != 0;
+    }
+
+    return population + step_cells(up, row, down, out, age, std::max(x, 1), w, w, decay, changed);
+}
+
+// interleaves one row of cells and ages into (alive, age) texels
+static size_t write_texels(uint8_t const *row, uint8_t const *age, int count, uint8_t *out)
+{
+    size_t visible = 0;
+    for (int x = 0; x < count; x++)
+    {
+        out[2 * x] = row[x];
+        out[2 * x + 1] = age[x];
+        visible += age[x] != 0;
+    }
+    return visible;
+}
+
+// rows [y0, y1) of the next generation. Only reads cells and only writes
+// these rows of next, age and texels, so bands of rows can run at the same time
+static size_t step_rows(Universe &universe, int y0, int y1, Texels *texels, bool &changed, size_t &visible)
+{
+    int w = universe.width;
+    int h = universe.height;
+    uint8_t const *cells = universe.cells.data();
+    uint8_t *next = universe.next.data();
+    uint8_t *age = universe.age.data();
+
+    size_t population = 0;
+    for (int y = y0; y < y1; y++)
+    {
+        uint8_t const *up = cells + (size_t)((y + h - 1) % h) * w;
+        uint8_t const *row = cells + (size_t)y * w;
+        uint8_t const *down = cells + (size_t)((y + 1) % h) * w;
+
+        population += step_row(up, row, down, next + (size_t)y * w, age + (size_t)y * w, w, universe.decay, changed);
+
+        if (texels && y >= texels->region.y && y < texels->region.y + texels->region.height)
+        {
+            Region &region = texels->region;
+            size_t offset = (size_t)y * w + region.x;
+            uint8_t *out = texels->data + 2 * (size_t)(y - region.y) * region.width;
+            visible += write_texels(next + offset, age + offset, region.width, out);
+        }
+    }
+    return population;
+}
+
+// the bands of a threaded step. Each NUMA node of the pool gets a contiguous
+// run of rows, starting on a huge page where the width allows, cut into its
+// share of the bands. Workers take the next band of their own node before
+// helping the others
+struct BandQueue
+{
+    int bands;
+    int nodes;
+    int first[MAX_NUMA_NODES + 1];
+    int first_row[MAX_NUMA_NODES + 1];
+    std::atomic<int> next[MAX_NUMA_NODES];
+};
+
+void init_bands(BandQueue &queue, int width, int height, ThreadPool const &pool)
+{
+    queue.bands = std::min(height, (int)pool.threads.size() * STEP_BANDS_PER_THREAD);
+    queue.nodes = std::max(1, std::min(pool.nodes, queue.bands));
+
+    // rows between huge page boundaries, planes start on one, see map_plane
+    size_t a = HUGE_PAGE, b = (size_t)width;
+    while (b)
+    {
+        size_t r = a % b;
+        a = b;
+        b = r;
+    }
+    int align = (int)(HUGE_PAGE / a);
+    if ((int64_t)align * queue.nodes > height)
+        align = 1;
+
+    for (int n = 0; n <= queue.nodes; n++)
+    {
+        int row = (int)((int64_t)height * n / queue.nodes);
+        queue.first[n] = queue.bands * n / queue.nodes;
+        queue.first_row[n] = std::min(height, (row + align / 2) / align * align);
+    }
+    queue.first_row[queue.nodes] = height;
+    for (int n = 0; n < queue.nodes; n++)
+        queue.next[n] = queue.first[n];
+}
+
+// the rows of a band, y0 == y1 for an empty one
+void band_rows(BandQueue const &queue, int band, int &y0, int &y1)
+{
+    int node = 0;
+    while (band >= queue.first[node + 1])
+        node++;
+    int rows = queue.first_row[node + 1] - queue.first_row[node];
+    int bands = queue.first[node + 1] - queue.first[node];
+    int index = band - queue.first[node];
+    y0 = queue.first_row[node] + (int)((int64_t)rows * index / bands);
+    y1 = queue.first_row[node] + (int)((int64_t)rows * (index + 1) / bands);
+}
+
+// a band of the worker's own node, -1 once they are all taken
+int claim_local_band(BandQueue &queue)
+{
+    int node = worker_node % queue.nodes;
+    int band = queue.next[node].fetch_add(1, std::memory_order_relaxed);
+    return band < queue.first[node + 1] ? band : -1;
+}
+
+// -1 once every band is taken
+int claim_band(BandQueue &queue)
+{
+    for (int i = 0; i < queue.nodes; i++)
+    {
+        int node = (worker_node + i) % queue.nodes;
+        int band = queue.next[node].fetch_add(1, std::memory_order_relaxed);
+        if (band < queue.first[node + 1])
+            return band;
+    }
+    return -1;
+}
+
+// one generation of B3/S23 on a torus, ages updated in the same pass. With
+// texels, the rows inside texels->region are also written out for display
+// while they are still in cache. With a pool of more than one thread the rows
+// are split into bands stepped in parallel
+void step_universe(Universe &universe, Texels *texels = NULL, ThreadPool *pool = NULL)
+{
+    int h = universe.height;
+
+    size_t population = 0;
+    bool changed = false;
+    size_t visible = 0;
+    if (pool && pool->threads.size() > 1)
+    {
+        BandQueue queue;
+        init_bands(queue, universe.width, h, *pool);
+
+        struct Band
+        {
+            size_t population;
+            size_t visible;
+            bool changed;
+        };
+        std::vector<Band> results(queue.bands, Band{0, 0, false});
+        std::atomic<int> finished(0);
+        for (int i = 0; i < queue.bands; i++)
+        {
+            pool_submit(*pool, [&universe, &queue, &results, &finished, texels]
+            {
+                int b = claim_band(queue);
+                int y0 = 0, y1 = 0;
+                if (b >= 0)
+                    band_rows(queue, b, y0, y1);
+                if (y0 < y1)
+                {
+                    Zone zone("step band");
+                    Band &band = results[b];
+                    band.population = step_rows(universe, y0, y1, texels, band.changed, band.visible);
+                }
+                finished.fetch_add(1, std::memory_order_release);
+            });
+        }
+        // just these bands, headless video shades frames on the same pool
+        pool_wait(*pool, [&finished, &queue] { return finished.load(std::memory_order_acquire) == queue.bands; });
+
+        for (Band const &band : results)
+        {
+            population += band.population;
+            visible += band.visible;
+            changed |= band.changed;
+        }
+    }
+    else
+    {
+        population = step_rows(universe, 0, h, texels, changed, visible);
+    }
+
+    if (texels)
+        texels->visible += visible;
+    universe.cells.swap(universe.next);
+    universe.population = population;
+    universe.generation++;
+    universe.settled = !changed;
+}
+
+// clears the planes on the pool, every band by a worker of the node
+// step_universe gives it to. Pages go to the node that touches them first, so
+// this has to run before anything else writes a fresh universe. Unlike the
+// step nobody helps another node, each worker takes exactly one task and
+// holds on to it until all of them have one, so every node clears its own
+void touch_universe(Universe &universe, ThreadPool &pool)
+{
+    if (pool.threads.size() <= 1)
+        return;
+
+    BandQueue queue;
+    init_bands(queue, universe.width, universe.height, pool);
+    int workers = (int)pool.threads.size();
+    std::atomic<int> arrived(0);
+    for (int i = 0; i < workers; i++)
+    {
+        pool_submit(pool, [&universe, &queue, &arrived, workers]
+        {
+            for (int b = claim_local_band(queue); b >= 0; b = claim_local_band(queue))
+            {
+                int y0, y1;
+                band_rows(queue, b, y0, y1);
+                size_t offset = (size_t)y0 * universe.width;
+                size_t bytes = (size_t)(y1 - y0) * universe.width;
+                memset(universe.cells.data() + offset, 0, bytes);
+                memset(universe.next.data() + offset, 0, bytes);
+                memset(universe.age.data() + offset, 0, bytes);
+            }
+
+            arrived.fetch_add(1);
+            while (arrived.load() < workers)
+                std::this_thread::yield();
+        });
+    }
+    pool_wait_all(pool);
+}
+
+// the reference engine, every cell through step_cells. Slow, but simple enough
+// to trust when checking and benchmarking the others
+void step_universe_scalar(Universe &universe)
+{
+    int w = universe.width;
+    int h = universe.height;
+    uint8_t const *cells = universe.cells.data();
+    uint8_t *next = universe.next.data();
+    uint8_t *age = universe.age.data();
+
+    size_t population = 0;
+    bool changed = false;
+    for (int y = 0; y < h; y++)
+    {
+        uint8_t const *up = cells + (size_t)((y + h - 1) % h) * w;
+        uint8_t const *row = cells + (size_t)y * w;
+        uint8_t const *down = cells + (size_t)((y + 1) % h) * w;
+        population += step_cells(up, row, down, next + (size_t)y * w, age + (size_t)y * w, 0, w, w, universe.decay, changed);
+    }
+
+    universe.cells.swap(universe.next);
+    universe.population = population;
+    universe.generation++;
+    universe.settled = !changed;
+}
+
+// copies the cells inside region to out as (alive, age) byte pairs, row by row,
+// and returns how many are visible: alive, or still trailing when trails are on
+size_t read_region(Universe const &universe, Region region, uint8_t *out)
+{
+    size_t visible = 0;
+    for (int y = 0; y < region.height; y++)
+    {
+        size_t offset = (size_t)(region.y + y) * universe.width + region.x;
+        visible += write_texels(universe.cells.data() + offset, universe.age.data() + offset, region.width, out);
+        out += 2 * region.width;
+    }
+    return visible;
+}
+
+// appends x, y, alive << 8 | age for every visible cell inside region to out
+size_t gather_live(Universe const &universe, Region region, TrackedVector<int32_t, MEMORY_RENDER> &out)
+{
+    size_t start = out.size();
+    for (int y = region.y; y < region.y + region.height; y++)
+    {
+        size_t offset = (size_t)y * universe.width;
+        uint8_t const *row = universe.cells.data() + offset;
+        uint8_t const *age = universe.age.data() + offset;
+        for (int x = region.x; x < region.x + region.width; x++)
+        {
+            if (age[x])
+            {
+                out.push_back(x);
+                out.push_back(y);
+                out.push_back(row[x] << 8 | age[x]);
+            }
+        }
+    }
+    return (out.size() - start) / 3;
+}
+
+void fit_camera(Game &game)
+{
+    Universe &universe = game.universe;
+    Camera &camera = game.camera;
+
+    int fb_width, fb_height;
+    framebuffer_size(game, fb_width, fb_height);
+
+    camera.x = universe.width / 2.0;
+    camera.y = universe.height / 2.0;
+    camera.zoom = std::min((float)fb_width / universe.width, (float)fb_height / universe.height);
+}
+
+void view_origin(Camera const &camera, int fb_width, int fb_height, double &x, double &y)
+{
+    x = camera.x - fb_width / (2.0 * camera.zoom);
+    y = camera.y - fb_height / (2.0 * camera.zoom);
+}
+
+// the tiles that intersect the screen, clipped to the universe
+Region visible_tiles(Game &game, int fb_width, int fb_height)
+{
+    Universe &universe = game.universe;
+
+    double x0, y0;
+    view_origin(game.camera, fb_width, fb_height, x0, y0);
+    double x1 = x0 + fb_width / game.camera.zoom;
+    double y1 = y0 + fb_height / game.camera.zoom;
+
+    int tx0 = std::max(0, (int)std::floor(x0 / TILE_SIZE) * TILE_SIZE);
+    int ty0 = std::max(0, (int)std::floor(y0 / TILE_SIZE) * TILE_SIZE);
+    int tx1 = std::min(universe.width, (int)std::ceil(x1 / TILE_SIZE) * TILE_SIZE);
+    int ty1 = std::min(universe.height, (int)std::ceil(y1 / TILE_SIZE) * TILE_SIZE);
+
+    return Region{tx0, ty0, std::max(0, tx1 - tx0), std::max(0, ty1 - ty0)};
+}
+
+// framebuffer pixels per window coordinate, 2 on retina displays
+float framebuffer_scale(GLFWwindow *window)
+{
+    int width, height, fb_width, fb_height;
+    glfwGetWindowSize(window, &width, &height);
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+    return width > 0 ? (float)fb_width / width : 1.0f;
+}
+
+// the cell under a cursor position given in window coordinates
+void cursor_cell(Game &game, double xpos, double ypos, int &x, int &y)
+{
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(game.window, &fb_width, &fb_height);
+
+    double origin_x, origin_y;
+    view_origin(game.camera, fb_width, fb_height, origin_x, origin_y);
+
+    float scale = framebuffer_scale(game.window);
+    x = (int)std::floor(origin_x + xpos * scale / game.camera.zoom);
+    y = (int)std::floor(origin_y + ypos * scale / game.camera.zoom);
+}
+
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+    ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
+    wake(window);
+
+    Game &game = *(Game *)glfwGetWindowUserPointer(window);
+    Camera &camera = game.camera;
+    Selection &selection = game.selection;
+
+    bool pressed = action == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse;
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT)
+    {
+        if (pressed)
+        {
+            camera.dragging = true;
+            glfwGetCursorPos(window, &camera.drag_x, &camera.drag_y);
+        }
+        else if (action == GLFW_RELEASE)
+        {
+            camera.dragging = false;
+        }
+    }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT)
+    {
+        // right-drag selects a rectangle, a right click without dragging clears it
+        if (pressed)
+        {
+            double xpos, ypos;
+            glfwGetCursorPos(window, &xpos, &ypos);
+            cursor_cell(game, xpos, ypos, selection.x0, selection.y0);
+            selection.x1 = selection.x0;
+            selection.y1 = selection.y0;
+            selection.selecting = true;
+            selection.active = false;
+        }
+        else if (action == GLFW_RELEASE)
+        {
+            selection.selecting = false;
+        }
+    }
+}
+
+void cursor_pos_callback(GLFWwindow *window, double xpos, double ypos)
+{
+    wake(window);
+
+    Game &game = *(Game *)glfwGetWindowUserPointer(window);
+    Camera &camera = game.camera;
+    Selection &selection = game.selection;
+
+    if (selection.selecting)
+    {
+        cursor_cell(game, xpos, ypos, selection.x1, selection.y1);
+        selection.active = selection.x1 != selection.x0 || selection.y1 != selection.y0;
+    }
+
+    if (!camera.dragging)
+        return;
+
+    float scale = framebuffer_scale(window);
+    camera.x -= (xpos - camera.drag_x) * scale / camera.zoom;
+    camera.y -= (ypos - camera.drag_y) * scale / camera.zoom;
+    camera.drag_x = xpos;
+    camera.drag_y = ypos;
+}
+
+void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
+{
+    ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
+    wake(window);
+
+    Game &game = *(Game *)glfwGetWindowUserPointer(window);
+    Camera &camera = game.camera;
+
+    if (ImGui::GetIO().WantCaptureMouse)
+        return;
+
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    float scale = framebuffer_scale(window);
+    double px = xpos * scale - fb_width / 2.0;
+    double py = ypos * scale - fb_height / 2.0;
+
+    // keep the cell under the cursor where it is
+    double cell_x = camera.x + px / camera.zoom;
+    double cell_y = camera.y + py / camera.zoom;
+    camera.zoom = std::clamp(camera.zoom * std::pow(1.1f, (float)yoffset), MIN_ZOOM, MAX_ZOOM);
+    camera.x = cell_x - px / camera.zoom;
+    camera.y = cell_y - py / camera.zoom;
+}
+
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        trace_requested = 1;
+    wake(window);
+}
+
+void char_callback(GLFWwindow *window, unsigned int c)
+{
+    ImGui_ImplGlfw_CharCallback(window, c);
+    wake(window);
+}
+
+// the ImGui bindings are installed without their own callbacks, these feed them
+// and the camera from the same GLFW events
+void install_callbacks(Game &game)
+{
+    glfwSetWindowUserPointer(game.window, &game);
+    glfwSetMouseButtonCallback(game.window, mouse_button_callback);
+    glfwSetCursorPosCallback(game.window, cursor_pos_callback);
+    glfwSetScrollCallback(game.window, scroll_callback);
+    glfwSetKeyCallback(game.window, key_callback);
+    glfwSetCharCallback(game.window, char_callback);
+    glfwSetWindowRefreshCallback(game.window, window_refresh_callback);
+}
+
+// nothing to draw when the universe isn't moving and no event asked for a
+// frame. The Escape key is polled rather than delivered, but pressing it still
+// wakes the loop through the key callback
+bool can_idle(Game &game)
+{
+    return game.idle && game.redraw == 0 && game.capture.in_flight == 0 && (game.paused || game.universe.settled);
+}
+
+// linear ramp through evenly spaced RGB stops into count RGBA texels
+void fill_gradient(uint8_t *out, int count, float const (*stops)[3], int stop_count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float t = (float)i / (count - 1) * (stop_count - 1);
+        int s = std::min((int)t, stop_count - 2);
+        float f = t - s;
+        for (int c = 0; c < 3; c++)
+            out[4 * i + c] = (uint8_t)std::lround(255.0f * (stops[s][c] + (stops[s + 1][c] - stops[s][c]) * f));
+        out[4 * i + 3] = 255;
+    }
+}
+
+// row 0 colors live cells by age, young and hot to old and cold, row 1 colors
+// dead cells by how much of their trail is left. Live cells are at least 1 old,
+// so row 0 starts bright
+void build_palette(uint8_t (*palette)[256 * 4])
+{
+    static const float age_stops[][3] = {
+        {1.0f, 1.0f, 0.85f}, {1.0f, 0.8f, 0.1f}, {0.9f, 0.2f, 0.1f},
+        {0.5f, 0.1f, 0.6f}, {0.15f, 0.25f, 0.7f}, {0.1f, 0.2f, 0.45f},
+    };
+    static const float trail_stops[][3] = {
+        {0.0f, 0.0f, 0.0f}, {0.1f, 0.05f, 0.15f}, {0.35f, 0.1f, 0.3f}, {0.7f, 0.25f, 0.25f},
+    };
+    fill_gradient(palette[0], 256, age_stops, IM_ARRAYSIZE(age_stops));
+    fill_gradient(palette[1], 256, trail_stops, IM_ARRAYSIZE(trail_stops));
+}
+
+// same mapping as the fragment shader, in floats so cell edges land on the
+// same pixels
+void make_raster_view(Game &game, int width, int height, RasterView &view)
+{
+    double origin_x, origin_y;
+    view_origin(game.camera, width, height, origin_x, origin_y);
+    float cell_size = game.camera.zoom;
+
+    view.width = width;
+    view.height = height;
+    view.region = visible_tiles(game, width, height);
+
+    view.columns.resize(width);
+    for (int x = 0; x < width; x++)
+    {
+        int c = (int)std::floor((float)origin_x + (x + 0.5f) / cell_size) - view.region.x;
+        view.columns[x] = c >= 0 && c < view.region.width ? c : -1;
+    }
+    view.rows.resize(height);
+    for (int y = 0; y < height; y++)
+    {
+        int r = (int)std::floor((float)origin_y + (y + 0.5f) / cell_size) - view.region.y;
+        view.rows[y] = r >= 0 && r < view.region.height ? r : -1;
+    }
+
+    uint8_t palette[2][256 * 4];
+    build_palette(palette);
+    uint8_t plain[4] = {(uint8_t)std::lround(game.r * 255), (uint8_t)std::lround(game.g * 255),
+                        (uint8_t)std::lround(game.b * 255), (uint8_t)std::lround(game.a * 255)};
+    uint8_t background[4] = {0, 0, 0, 255};
+    for (int age = 0; age < 256; age++)
+    {
+        memcpy(&view.colors[1][age], game.render.color_mode == COLOR_PLAIN ? plain : &palette[0][4 * age], 4);
+        memcpy(&view.colors[0][age], game.render.color_mode == COLOR_TRAIL ? &palette[1][4 * age] : background, 4);
+    }
+}
+
+// RGBA rows [y0, y1) of a frame, top to bottom, from the region's texels
+void rasterize_rows(RasterView const &view, uint8_t const *texels, int y0, int y1, uint32_t *out)
+{
+    uint32_t background = view.colors[0][0];
+    for (int y = y0; y < y1; y++)
+    {
+        uint32_t *pixel = out + (size_t)y * view.width;
+        int row = view.rows[y];
+        if (row < 0)
+        {
+            std::fill(pixel, pixel + view.width, background);
+            continue;
+        }
+
+        uint8_t const *cells = texels + 2 * (size_t)row * view.region.width;
+        for (int x = 0; x < view.width; x++)
+        {
+            int c = view.columns[x];
+            pixel[x] = c < 0 ? background : view.colors[cells[2 * c] != 0][cells[2 * c + 1]];
+        }
+    }
+}
+
+void gpu_timer_begin(Game &game, GpuPass pass)
+{
+    GpuTimers &gpu = game.gpu;
+
+    // a slot still waiting on the GPU is skipped rather than waited for
+    if (gpu.pending[gpu.frame][pass])
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, gpu.queries[gpu.frame][pass]);
+    gpu.active = pass;
+}
+
+void gpu_timer_end(Game &game)
+{
+    GpuTimers &gpu = game.gpu;
+
+    if (gpu.active < 0)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    gpu.pending[gpu.frame][gpu.active] = true;
+    gpu.active = -1;
+}
+
+// picks up whatever results are ready, without blocking, and moves on to the next slot
+void gpu_timers_end_frame(Game &game)
+{
+    GpuTimers &gpu = game.gpu;
+
+    for (int frame = 0; frame < GPU_TIMER_FRAMES; frame++)
+    {
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        {
+            if (!gpu.pending[frame][pass])
+                continue;
+
+            GLint available = 0;
+            glGetQueryObjectiv(gpu.queries[frame][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(gpu.queries[frame][pass], GL_QUERY_RESULT, &ns);
+            gpu.ms[pass] += (ns / 1e6f - gpu.ms[pass]) * 0.1f;
+            gpu.pending[frame][pass] = false;
+        }
+    }
+
+    gpu.frame = (gpu.frame + 1) % GPU_TIMER_FRAMES;
+}
+
+int setup_render(Game &game)
+{
+    // the full-screen pass generates its triangle from gl_VertexID, but core
+    // profile still wants a VAO bound
+    glGenVertexArrays(1, &game.VAO);
+
+    glGenTextures(1, &game.render.texture);
+    glBindTexture(GL_TEXTURE_2D, game.render.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    uint8_t palette[2][256 * 4];
+    build_palette(palette);
+
+    glGenTextures(1, &game.render.palette);
+    glBindTexture(GL_TEXTURE_2D, game.render.palette);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette);
+
+    glGenBuffers(1, &game.render.pbo);
+
+    glGenTextures(1, &game.render.frame_texture);
+    glBindTexture(GL_TEXTURE_2D, game.render.frame_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenFramebuffers(1, &game.render.frame_fbo);
+
+    glGenQueries(GPU_TIMER_FRAMES * GPU_PASS_COUNT, &game.gpu.queries[0][0]);
+    game.gpu.active = -1;
+
+    glGenVertexArrays(1, &game.render.instance_vao);
+    glBindVertexArray(game.render.instance_vao);
+
+    glGenBuffers(1, &game.render.instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, game.render.instance_vbo);
+
+    // cell coordinate and state, advanced once per quad
+    glVertexAttribIPointer(0, 3, GL_INT, 3 * sizeof(int32_t), (void *)0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+
+    return 0;
+}
+
+// an offscreen GL 3.3 core context rendering into an X by Y framebuffer object
+int init_offscreen_gl(Game &game)
+{
+#ifdef CONWAY_EGL
+    // the surfaceless platform needs neither a display server nor a GPU
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        return -1;
+    }
+
+    EGLint const config_attribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint config_count = 0;
+    eglChooseConfig(display, config_attribs, &config, 1, &config_count);
+
+    EGLint const context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config_count ? config : (EGLConfig)0, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cout << "Failed to create offscreen GL context" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+    game.egl.display = display;
+    game.egl.context = context;
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    glGenRenderbuffers(1, &game.fbo_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, game.fbo_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, game.X, game.Y);
+
+    glGenFramebuffers(1, &game.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, game.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, game.fbo_color);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+        return -1;
+    }
+
+    glViewport(0, 0, game.X, game.Y);
+
+    return 0;
+#else
+    std::cout << "Offscreen rendering needs EGL, which isn't available on this platform" << std::endl;
+    return -1;
+#endif
+}
+
+// ImGui frees without a size, so it goes in front of each block
+const size_t UI_ALLOCATION_HEADER = 16;
+
+void *ui_alloc(size_t size, void *user_data)
+{
+    char *block = (char *)malloc(size + UI_ALLOCATION_HEADER);
+    if (!block)
+        return NULL;
+    *(size_t *)block = size;
+    track_memory(MEMORY_UI, (int64_t)size);
+    return block + UI_ALLOCATION_HEADER;
+}
+
+void ui_free(void *ptr, void *user_data)
+{
+    if (!ptr)
+        return;
+    char *block = (char *)ptr - UI_ALLOCATION_HEADER;
+    track_memory(MEMORY_UI, -(int64_t)*(size_t *)block);
+    free(block);
+}
+
+// gives ImGui the atlas baked into assets.h, so ImFontAtlas::Build never runs.
+// The pixels are copied since the atlas frees them itself
+void install_font_atlas(ImFontAtlas *atlas)
+{
+    ImFontConfig config;
+    config.FontDataOwnedByAtlas = false;
+    config.SizePixels = FONT_SIZE;
+    snprintf(config.Name, sizeof(config.Name), "baked, %dpx", (int)FONT_SIZE);
+    atlas->ConfigData.push_back(config);
+
+    size_t size = (size_t)FONT_ATLAS_WIDTH * FONT_ATLAS_HEIGHT;
+    atlas->TexPixelsAlpha8 = (unsigned char *)ImGui::MemAlloc(size);
+    memcpy(atlas->TexPixelsAlpha8, FONT_ATLAS_PIXELS, size);
+    atlas->TexWidth = FONT_ATLAS_WIDTH;
+    atlas->TexHeight = FONT_ATLAS_HEIGHT;
+    atlas->TexUvScale = ImVec2(1.0f / FONT_ATLAS_WIDTH, 1.0f / FONT_ATLAS_HEIGHT);
+    atlas->TexUvWhitePixel = ImVec2(FONT_WHITE_PIXEL[0], FONT_WHITE_PIXEL[1]);
+
+    for (BakedRect const &baked : FONT_RECTS)
+    {
+        ImFontAtlas::CustomRect rect;
+        rect.ID = baked.id;
+        rect.Width = baked.width;
+        rect.Height = baked.height;
+        rect.X = baked.x;
+        rect.Y = baked.y;
+        atlas->CustomRects.push_back(rect);
+    }
+    atlas->CustomRectIds[0] = FONT_MOUSE_CURSOR_RECT;
+
+    ImFont *font = IM_NEW(ImFont);
+    font->FontSize = FONT_SIZE;
+    font->Ascent = FONT_ASCENT;
+    font->Descent = FONT_DESCENT;
+    font->DisplayOffset = ImVec2(FONT_DISPLAY_OFFSET[0], FONT_DISPLAY_OFFSET[1]);
+    font->ContainerAtlas = atlas;
+    font->ConfigData = &atlas->ConfigData.back();
+    font->ConfigDataCount = 1;
+    for (BakedGlyph const &baked : FONT_GLYPHS)
+    {
+        ImFontGlyph glyph = {baked.codepoint, baked.advance, baked.x0, baked.y0, baked.x1, baked.y1, baked.u0, baked.v0, baked.u1, baked.v1};
+        font->Glyphs.push_back(glyph);
+    }
+    font->SetFallbackChar(FONT_FALLBACK_CHAR);
+    atlas->Fonts.push_back(font);
+}
+
+void processInput(Game &game)
+{
+    Zone zone("input");
+    game.time.input = glfwGetTime();
+
+    if (glfwGetKey(game.window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(game.window, true);
+
+    double xpos, ypos;
+    glfwGetCursorPos(game.window, &xpos, &ypos);
+    cursor_cell(game, xpos, ypos, game.hover_x, game.hover_y);
+
+    Universe &universe = game.universe;
+    game.hovering = !ImGui::GetIO().WantCaptureMouse
+        && game.hover_x >= 0 && game.hover_x < universe.width
+        && game.hover_y >= 0 && game.hover_y < universe.height;
+}
+
+bool use_instanced(Game &game)
+{
+    if (game.render.mode == RENDER_CPU)
+        return false;
+    if (game.render.mode != RENDER_AUTO)
+        return game.render.mode == RENDER_INSTANCED;
+
+    if (game.render.instanced)
+        return game.render.density < INSTANCED_LEAVE_DENSITY;
+    return game.render.density < INSTANCED_ENTER_DENSITY;
+}
+
+// shades the visible region into render.pixels, a band of rows per task, and
+// uploads it as the frame texture. Returns the visible cell count
+size_t render_cpu(Game &game, int fb_width, int fb_height)
+{
+    Universe &universe = game.universe;
+    Region region = game.render.region;
+
+    size_t live;
+    TrackedVector<uint8_t, MEMORY_RENDER> &staging = game.render.staging;
+    if (game.render.staged)
+    {
+        live = game.render.texels.visible;
+        game.render.staged = false;
+    }
+    else
+    {
+        staging.resize(2 * (size_t)region.width * region.height);
+        live = read_region(universe, region, staging.data());
+    }
+
+    if (game.pool.threads.empty())
+        start_pool(game.pool, game.options.threads);
+
+    RasterView &view = game.render.view;
+    make_raster_view(game, fb_width, fb_height, view);
+    TrackedVector<uint32_t, MEMORY_RENDER> &pixels = game.render.pixels;
+    pixels.resize((size_t)fb_width * fb_height);
+
+    uint8_t const *texels = staging.data();
+    uint32_t *out = pixels.data();
+    for (int y = 0; y < fb_height; y += CPU_BAND_ROWS)
+    {
+        int y1 = std::min(y + CPU_BAND_ROWS, fb_height);
+        pool_submit(game.pool, [&view, texels, y, y1, out]
+        {
+            Zone zone("shade");
+            rasterize_rows(view, texels, y, y1, out);
+        });
+    }
+    pool_wait_all(game.pool);
+
+    {
+        Zone zone("upload");
+        gpu_timer_begin(game, GPU_PASS_UPLOAD);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, game.render.frame_texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (fb_width != game.render.frame_width || fb_height != game.render.frame_height)
+        {
+            game.render.frame_width = fb_width;
+            game.render.frame_height = fb_height;
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, fb_width, fb_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, fb_width, fb_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        gpu_timer_end(game);
+    }
+
+    // a blit rather than a full-screen pass, so nothing is shaded per pixel.
+    // The rows are top first, flipped on the way
+    gpu_timer_begin(game, GPU_PASS_CELLS);
+    int target;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, game.render.frame_fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, game.render.frame_texture, 0);
+    glBlitFramebuffer(0, 0, fb_width, fb_height, 0, fb_height, fb_width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+    gpu_timer_end(game);
+
+    return live;
+}
+
+// decides what this frame draws before the universe steps, so a fused step
+// knows which texels to produce
+void plan_frame(Game &game)
+{
+    int fb_width, fb_height;
+    framebuffer_size(game, fb_width, fb_height);
+
+    game.render.region = visible_tiles(game, fb_width, fb_height);
+    game.render.instanced = use_instanced(game);
+}
+
+// maps the unpack buffer for the visible region and returns where the step
+// should write texels, or NULL when this frame won't use them
+Texels *begin_fused_step(Game &game)
+{
+    Region region = game.render.region;
+    size_t size = 2 * (size_t)region.width * region.height;
+    if (!game.render.fused || game.render.instanced || size == 0)
+        return NULL;
+
+    // the CPU renderer reads texels from memory, no need to go through GL
+    if (game.render.mode == RENDER_CPU)
+    {
+        game.render.staging.resize(size);
+        game.render.texels = Texels{region, game.render.staging.data(), 0};
+        return &game.render.texels;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, game.render.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!data)
+        return NULL;
+
+    game.render.texels = Texels{region, (uint8_t *)data, 0};
+    return &game.render.texels;
+}
+
+void end_fused_step(Game &game, Texels *texels)
+{
+    if (!texels)
+        return;
+
+    if (game.render.mode == RENDER_CPU)
+    {
+        game.render.staged = true;
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, game.render.pbo);
+    // the contents are undefined if the driver lost them, read the grid back instead
+    game.render.fused_ready = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// generations to run this frame. Budget mode runs what the target rate has
+// accumulated in accum_time since the last frame, capped by how many steps fit
+// in the budget at the measured cost
+int plan_steps(Game &game)
+{
+    Scheduler &schedule = game.schedule;
+    if (game.paused || game.universe.settled)
+    {
+        game.accum_time = 0.0f;
+        return 0;
+    }
+
+    if (schedule.mode == SCHEDULE_FRAME)
+        return 1;
+
+    // a single step until there is a cost to go by
+    int fit = schedule.step_ms > 0.0f ? std::max(1, (int)(schedule.budget_ms / schedule.step_ms)) : 1;
+    if (schedule.mode == SCHEDULE_TURBO || schedule.target_rate <= 0.0f)
+        return fit;
+
+    int count = std::min((int)(game.accum_time * schedule.target_rate), fit);
+    game.accum_time -= count / schedule.target_rate;
+    // when the budget can't keep up, drop what's owed rather than catching up later
+    game.accum_time = std::min(game.accum_time, 1.0f / schedule.target_rate);
+    return count;
+}
+
+int histogram_bucket(float ms)
+{
+    if (ms <= HISTOGRAM_MIN_MS)
+        return 0;
+    int bucket = (int)(std::log2(ms / HISTOGRAM_MIN_MS) * HISTOGRAM_PER_OCTAVE);
+    return std::min(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+float bucket_ms(int bucket)
+{
+    return HISTOGRAM_MIN_MS * std::exp2((float)bucket / HISTOGRAM_PER_OCTAVE);
+}
+
+void add_sample(Histogram &histogram, float ms)
+{
+    if (histogram.count == HISTOGRAM_SAMPLES)
+        histogram.buckets[histogram_bucket(histogram.samples[histogram.next])]--;
+    else
+        histogram.count++;
+    histogram.samples[histogram.next] = ms;
+    histogram.buckets[histogram_bucket(ms)]++;
+    histogram.next = (histogram.next + 1) % HISTOGRAM_SAMPLES;
+    histogram.total++;
+    histogram.total_ms += ms;
+}
+
+// exact, from the samples rather than the buckets
+float histogram_percentile(Histogram const &histogram, float p)
+{
+    if (histogram.count == 0)
+        return 0.0f;
+    std::vector<float> samples(histogram.samples, histogram.samples + histogram.count);
+    size_t rank = std::min((size_t)(p * histogram.count), samples.size() - 1);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+float histogram_max(Histogram const &histogram)
+{
+    return histogram.count ? *std::max_element(histogram.samples, histogram.samples + histogram.count) : 0.0f;
+}
+
+// runs count generations, only the last one writes texels when the frame is drawn
+void run_steps(Game &game, int count, bool present)
+{
+    Scheduler &schedule = game.schedule;
+    schedule.batch = count;
+    if (count == 0)
+        return;
+
+    Zone zone("step");
+    PerfCounters &perf = game.perf;
+    uint64_t before[PERF_COUNTERS];
+    read_perf_counters(perf, before);
+    double start = glfwGetTime();
+    for (int i = 0; i < count - 1 && !game.universe.settled; i++)
+        step_universe(game.universe);
+    if (!game.universe.settled)
+    {
+        Texels *texels = present ? begin_fused_step(game) : NULL;
+        step_universe(game.universe, texels);
+        end_fused_step(game, texels);
+    }
+
+    uint64_t after[PERF_COUNTERS];
+    read_perf_counters(perf, after);
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        float per_generation = (float)(after[i] - before[i]) / count;
+        perf.per_generation[i] += (per_generation - perf.per_generation[i]) * STEP_COST_SMOOTHING;
+    }
+
+    float ms = (float)(glfwGetTime() - start) * 1000.0f / count;
+    add_sample(game.histograms.step, ms * count);
+    if (schedule.step_ms == 0.0f)
+        schedule.step_ms = ms;
+    schedule.step_ms += (ms - schedule.step_ms) * STEP_COST_SMOOTHING;
+    schedule.steps += count;
+}
+
+void measure_rate(Game &game)
+{
+    Scheduler &schedule = game.schedule;
+    double elapsed = game.time.now - schedule.rate_time;
+    if (elapsed < RATE_INTERVAL)
+        return;
+
+    schedule.rate = (float)((schedule.steps - schedule.rate_steps) / elapsed);
+    schedule.rate_steps = schedule.steps;
+    schedule.rate_time = game.time.now;
+}
+
+void renderWindow(Game &game)
+{
+    Zone zone("render");
+    Universe &universe = game.universe;
+
+    int fb_width, fb_height;
+    framebuffer_size(game, fb_width, fb_height);
+
+    double origin_x, origin_y;
+    view_origin(game.camera, fb_width, fb_height, origin_x, origin_y);
+
+    Region region = game.render.region;
+
+    glUseProgram(game.shaderProgram);
+
+    // glClearColor(0.8f, 0.0f, 0.4f, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUniform4f(game.color_location, game.r, game.g, game.b, game.a);
+    glUniform2f(game.uniforms.viewport, (float)fb_width, (float)fb_height);
+    glUniform2f(game.uniforms.view_origin, (float)origin_x, (float)origin_y);
+    glUniform1f(game.uniforms.cell_size, game.camera.zoom);
+    glUniform1i(game.uniforms.color_mode, game.render.color_mode);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, game.render.palette);
+    glUniform1i(game.uniforms.palette, 1);
+
+    size_t area = (size_t)region.width * region.height;
+    size_t live = 0;
+
+    if (area == 0)
+    {
+        // nothing of the universe is on screen
+        gpu_timer_begin(game, GPU_PASS_CELLS);
+        glUniform1i(game.uniforms.mode, 0);
+        glUniform4i(game.uniforms.region, 0, 0, 0, 0);
+        glBindVertexArray(game.VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        gpu_timer_end(game);
+    }
+    else if (game.render.mode == RENDER_CPU)
+    {
+        live = render_cpu(game, fb_width, fb_height);
+    }
+    else if (game.render.instanced)
+    {
+        TrackedVector<int32_t, MEMORY_RENDER> &instances = game.render.instances;
+        {
+            Zone zone("upload");
+            instances.clear();
+            live = gather_live(universe, region, instances);
+
+            // orphan last frame's storage instead of waiting for the GPU to finish with it
+            gpu_timer_begin(game, GPU_PASS_UPLOAD);
+            glBindBuffer(GL_ARRAY_BUFFER, game.render.instance_vbo);
+            glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(int32_t), instances.data(), GL_STREAM_DRAW);
+            gpu_timer_end(game);
+        }
+
+        gpu_timer_begin(game, GPU_PASS_CELLS);
+        glUniform1i(game.uniforms.mode, 1);
+        glBindVertexArray(game.render.instance_vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(instances.size() / 3));
+        gpu_timer_end(game);
+    }
+    else
+    {
+        {
+            Zone zone("upload");
+            gpu_timer_begin(game, GPU_PASS_UPLOAD);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, game.render.texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+            // the texture only ever grows, the region uniform says how much of it is in use
+            if (region.width > game.render.texture_width || region.height > game.render.texture_height)
+            {
+                game.render.texture_width = std::max(region.width, game.render.texture_width);
+                game.render.texture_height = std::max(region.height, game.render.texture_height);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, game.render.texture_width, game.render.texture_height, 0, GL_RG, GL_UNSIGNED_BYTE, NULL);
+            }
+
+            if (game.render.fused_ready)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, game.render.pbo);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, region.width, region.height, GL_RG, GL_UNSIGNED_BYTE, (void *)0);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                live = game.render.texels.visible;
+                game.render.fused_ready = false;
+            }
+            else
+            {
+                TrackedVector<uint8_t, MEMORY_RENDER> &staging = game.render.staging;
+                staging.resize(2 * area);
+                live = read_region(universe, region, staging.data());
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, region.width, region.height, GL_RG, GL_UNSIGNED_BYTE, staging.data());
+            }
+            gpu_timer_end(game);
+        }
+
+        gpu_timer_begin(game, GPU_PASS_CELLS);
+        glUniform1i(game.uniforms.mode, 0);
+        glUniform1i(game.uniforms.cells, 0);
+        glUniform4i(game.uniforms.region, region.x, region.y, region.width, region.height);
+        glBindVertexArray(game.VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        gpu_timer_end(game);
+    }
+
+    game.render.density = area ? (float)live / area : 0.0f;
+
+    // grid, selection and hover are drawn by the fragment shader over the cells,
+    // so their cost doesn't depend on how many lines or cells are on screen. With
+    // none of them showing there's no need to shade the screen a second time
+    Selection &selection = game.selection;
+    if (game.camera.zoom < GRID_MIN_CELL_SIZE && !game.hovering && !selection.active)
+        return;
+
+    glUniform1i(game.uniforms.mode, 2);
+    glUniform2i(game.uniforms.universe_size, universe.width, universe.height);
+    if (game.hovering)
+        glUniform2i(game.uniforms.hover, game.hover_x, game.hover_y);
+    else
+        glUniform2i(game.uniforms.hover, -1, -1);
+    if (selection.active)
+        glUniform4i(game.uniforms.selection,
+                    std::min(selection.x0, selection.x1), std::min(selection.y0, selection.y1),
+                    std::abs(selection.x1 - selection.x0) + 1, std::abs(selection.y1 - selection.y0) + 1);
+    else
+        glUniform4i(game.uniforms.selection, 0, 0, 0, 0);
+
+    gpu_timer_begin(game, GPU_PASS_OVERLAY);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(game.VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisable(GL_BLEND);
+    gpu_timer_end(game);
+}
+
+// bucket counts with a yellow line at p99 and a red one at the slowest sample,
+// the median and p99 are also in the overlay
+void draw_histogram(char const *label, Histogram const &histogram)
+{
+    float counts[HISTOGRAM_BUCKETS];
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        counts[b] = (float)histogram.buckets[b];
+
+    float p50 = histogram_percentile(histogram, 0.50f);
+    float p99 = histogram_percentile(histogram, 0.99f);
+    float max = histogram_max(histogram);
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "p50 %.2f  p99 %.2f  max %.2f ms", p50, p99, max);
+    ImGui::PlotHistogram(label, counts, HISTOGRAM_BUCKETS, 0, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+    // the item includes the label, and the bars are inset by the frame padding
+    ImGuiStyle const &style = ImGui::GetStyle();
+    ImVec2 lo = ImGui::GetItemRectMin();
+    ImVec2 hi = ImGui::GetItemRectMax();
+    hi.x -= ImGui::CalcTextSize(label).x + style.ItemInnerSpacing.x + style.FramePadding.x;
+    lo.x += style.FramePadding.x;
+    auto marker = [&](float ms, ImU32 color)
+    {
+        float position = ms <= HISTOGRAM_MIN_MS ? 0.0f : std::log2(ms / HISTOGRAM_MIN_MS) * HISTOGRAM_PER_OCTAVE;
+        float x = lo.x + (hi.x - lo.x) * std::min(position / HISTOGRAM_BUCKETS, 1.0f);
+        ImGui::GetWindowDrawList()->AddLine(ImVec2(x, lo.y), ImVec2(x, hi.y), color, 2.0f);
+    };
+    marker(p99, IM_COL32(255, 220, 60, 255));
+    marker(max, IM_COL32(255, 70, 70, 255));
+}
+
+ImU32 zone_color(char const *name)
+{
+    uint32_t hash = (uint32_t)fnv1a(0xcbf29ce484222325ull, name, strlen(name));
+    return ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.85f);
+}
+
+float span_ms(Profile const &profile, uint64_t start, uint64_t end)
+{
+    return profile.ticks_per_ms > 0.0 ? (float)((end - start) / profile.ticks_per_ms) : 0.0f;
+}
+
+// p50, p95 and p99 of ms, which gets sorted
+void percentiles(std::vector<float> &ms, float *out)
+{
+    std::sort(ms.begin(), ms.end());
+    float const ranks[3] = {0.50f, 0.95f, 0.99f};
+    for (int i = 0; i < 3; i++)
+        out[i] = ms.empty() ? 0.0f : ms[(size_t)(ranks[i] * (ms.size() - 1) + 0.5f)];
+}
+
+// the last PROFILE_FRAMES frames as bars split by the main thread's top level
+// zones, then one frame as a flame graph with a row per thread and depth, and
+// the time per frame in each zone. Clicking a bar picks the frame to show
+void draw_profile(Game &game)
+{
+    Profile &profile = game.profile;
+    ImGui::Checkbox("freeze", &profile.frozen);
+    ImGui::SameLine();
+    if (ImGui::Button("show slowest"))
+        profile.selected = -1;
+    ImGui::SameLine();
+    if (ImGui::Button("save trace (F12)"))
+        trace_requested = 1;
+    if (profile.count == 0)
+        return;
+
+    int first = (profile.next - profile.count + PROFILE_FRAMES) % PROFILE_FRAMES;
+    int slowest = first;
+    float max_ms = 1000.0f / 60.0f;
+    for (int i = 0; i < profile.count; i++)
+    {
+        int slot = (first + i) % PROFILE_FRAMES;
+        ProfileFrame const &frame = profile.frames[slot];
+        ProfileFrame const &worst = profile.frames[slowest];
+        if (frame.end - frame.start > worst.end - worst.start)
+            slowest = slot;
+        max_ms = std::max(max_ms, span_ms(profile, frame.start, frame.end));
+    }
+    int shown = profile.selected >= 0 ? profile.selected : slowest;
+
+    ImDrawList *draw = ImGui::GetWindowDrawList();
+    float width = std::max(ImGui::GetContentRegionAvailWidth(), 100.0f);
+    float bar = width / PROFILE_FRAMES;
+    float height = 60.0f;
+    float scale = height / max_ms;
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton("frames", ImVec2(width, height));
+    float bottom = origin.y + height;
+    for (int i = 0; i < profile.count; i++)
+    {
+        int slot = (first + i) % PROFILE_FRAMES;
+        ProfileFrame const &frame = profile.frames[slot];
+        float x0 = origin.x + i * bar;
+        float x1 = x0 + std::max(bar - 1.0f, 1.0f);
+        float ms = span_ms(profile, frame.start, frame.end);
+        draw->AddRectFilled(ImVec2(x0, bottom - ms * scale), ImVec2(x1, bottom), slot == shown ? IM_COL32(255, 255, 255, 255) : IM_COL32(90, 90, 90, 255));
+
+        float y = bottom;
+        for (ProfileSpan const &span : frame.spans)
+        {
+            if (span.thread != profile.main_thread || span.depth != 0)
+                continue;
+            float h = span_ms(profile, span.start, span.end) * scale;
+            draw->AddRectFilled(ImVec2(x0, y - h), ImVec2(x1, y), zone_color(span.name));
+            y -= h;
+        }
+
+        if (ImGui::IsItemHovered() && ImGui::IsMouseHoveringRect(ImVec2(x0, origin.y), ImVec2(x0 + bar, bottom)))
+        {
+            ImGui::SetTooltip("%.3f ms", ms);
+            if (ImGui::IsMouseClicked(0))
+                profile.selected = slot;
+        }
+    }
+    // a 60 Hz frame
+    float line = bottom - 1000.0f / 60.0f * scale;
+    draw->AddLine(ImVec2(origin.x, line), ImVec2(origin.x + width, line), IM_COL32(255, 80, 80, 160));
+
+    ProfileFrame const &frame = profile.frames[shown];
+    ImGui::Text("frame %.3f ms", span_ms(profile, frame.start, frame.end));
+
+    // rows, the main thread first
+    int depths[PROFILE_THREADS] = {};
+    for (ProfileSpan const &span : frame.spans)
+        depths[span.thread] = std::max(depths[span.thread], span.depth + 1);
+    int order[PROFILE_THREADS];
+    int threads = 0;
+    if (depths[profile.main_thread])
+        order[threads++] = profile.main_thread;
+    for (int t = 0; t < PROFILE_THREADS; t++)
+        if (depths[t] && t != profile.main_thread)
+            order[threads++] = t;
+
+    float row = ImGui::GetTextLineHeightWithSpacing();
+    float duration = (float)std::max<uint64_t>(frame.end - frame.start, 1);
+    for (int i = 0; i < threads; i++)
+    {
+        int t = order[i];
+        ZoneBuffer const *buffer = zones.buffers[t].load(std::memory_order_acquire);
+        ImGui::TextDisabled("%s", buffer->name);
+
+        origin = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton(buffer->name, ImVec2(width, depths[t] * row));
+        bool hovered = ImGui::IsItemHovered();
+        for (ProfileSpan const &span : frame.spans)
+        {
+            if (span.thread != t)
+                continue;
+
+            // zones that started before the frame or ended after it are cut off at its edges
+            uint64_t start = std::max(span.start, frame.start);
+            uint64_t end = std::min(span.end, frame.end);
+            if (end <= start)
+                continue;
+            ImVec2 lo(origin.x + (start - frame.start) / duration * width, origin.y + span.depth * row);
+            ImVec2 hi(std::max(origin.x + (end - frame.start) / duration * width, lo.x + 1.0f), lo.y + row - 1.0f);
+            draw->AddRectFilled(lo, hi, zone_color(span.name));
+            if (ImGui::CalcTextSize(span.name).x + 4.0f < hi.x - lo.x)
+                draw->AddText(ImVec2(lo.x + 2.0f, lo.y), IM_COL32(0, 0, 0, 255), span.name);
+            if (hovered && ImGui::IsMouseHoveringRect(lo, hi))
+                ImGui::SetTooltip("%s %.3f ms", span.name, span_ms(profile, span.start, span.end));
+        }
+    }
+
+    // per frame times, zones that ran on several threads add up. Only frames
+    // the zone ran in count
+    std::vector<char const *> names;
+    std::vector<std::vector<float>> times;
+    std::vector<float> frames;
+    for (int i = 0; i < profile.count; i++)
+    {
+        ProfileFrame const &frame = profile.frames[(first + i) % PROFILE_FRAMES];
+        frames.push_back(span_ms(profile, frame.start, frame.end));
+
+        size_t seen = names.size();
+        std::vector<float> sums(seen, -1.0f);
+        for (ProfileSpan const &span : frame.spans)
+        {
+            size_t n = std::find(names.begin(), names.end(), span.name) - names.begin();
+            if (n == names.size())
+            {
+                names.push_back(span.name);
+                times.emplace_back();
+            }
+            if (n >= sums.size())
+                sums.resize(n + 1, -1.0f);
+            sums[n] = std::max(sums[n], 0.0f) + span_ms(profile, span.start, span.end);
+        }
+        for (size_t n = 0; n < sums.size(); n++)
+            if (sums[n] >= 0.0f)
+                times[n].push_back(sums[n]);
+    }
+
+    float p[3];
+    ImGui::Text("%-12s %8s %8s %8s", "ms", "p50", "p95", "p99");
+    percentiles(frames, p);
+    ImGui::Text("%-12s %8.3f %8.3f %8.3f", "frame", p[0], p[1], p[2]);
+    for (size_t n = 0; n < names.size(); n++)
+    {
+        percentiles(times[n], p);
+        ImGui::Text("%-12s %8.3f %8.3f %8.3f", names[n], p[0], p[1], p[2]);
+    }
+}
+
+int write_ppm(CaptureJob const &job)
+{
+    std::ofstream file(job.filename.c_str(), std::ofstream::binary);
+    if (!file)
+    {
+        std::cout << "Failed to open " << job.filename << std::endl;
+        return -1;
+    }
+
+    // GL rows go bottom to top, PPM rows top to bottom
+    file << "P6\n" << job.width << " " << job.height << "\n255\n";
+    std::vector<uint8_t> row((size_t)job.width * 3);
+    for (int y = job.height - 1; y >= 0; y--)
+    {
+        uint8_t const *in = job.pixels.data() + (size_t)y * job.width * 4;
+        for (int x = 0; x < job.width; x++)
+            memcpy(&row[3 * x], in + 4 * x, 3);
+        file.write((char const *)row.data(), (std::streamsize)row.size());
+    }
+
+    return file ? 0 : -1;
+}
+
+void write_y4m_header(std::ostream &out, int width, int height)
+{
+    out << "YUV4MPEG2 W" << width << " H" << height << " F" << CAPTURE_FPS << ":1 Ip A1:1 C420jpeg\n";
+}
+
+// one 4:2:0 frame of BT.601 studio range YCbCr, the Y, Cb and Cr planes one
+// after the other. RGBA rows come top to bottom, or bottom to top as GL reads
+// them, and are cropped or padded with black to the stream size
+void convert_yuv420(uint8_t const *rgba, int width, int height, bool bottom_up,
+                    int stream_width, int stream_height, FrameBytes &yuv)
+{
+    int chroma_width = (stream_width + 1) / 2;
+    int chroma_height = (stream_height + 1) / 2;
+    size_t luma_size = (size_t)stream_width * stream_height;
+    size_t chroma_size = (size_t)chroma_width * chroma_height;
+    yuv.assign(luma_size + 2 * chroma_size, 128);
+    std::fill(yuv.begin(), yuv.begin() + luma_size, 16);
+
+    uint8_t *y_plane = yuv.data();
+    uint8_t *u_plane = y_plane + luma_size;
+    uint8_t *v_plane = u_plane + chroma_size;
+
+    for (int y = 0; y < std::min(height, stream_height); y++)
+    {
+        uint8_t const *in = rgba + (size_t)(bottom_up ? height - 1 - y : y) * width * 4;
+        for (int x = 0; x < std::min(width, stream_width); x++)
+        {
+            int r = in[4 * x], g = in[4 * x + 1], b = in[4 * x + 2];
+            y_plane[(size_t)y * stream_width + x] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+
+            // chroma from the top left pixel of each 2x2 block
+            if ((x | y) & 1)
+                continue;
+            size_t c = (size_t)(y / 2) * chroma_width + x / 2;
+            u_plane[c] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[c] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+void write_y4m_frame(std::ostream &out, FrameBytes const &yuv)
+{
+    out << "FRAME\n";
+    out.write((char const *)yuv.data(), (std::streamsize)yuv.size());
+}
+
+void capture_worker(Capture *capture)
+{
+    name_thread("capture");
+
+    std::unique_lock<std::mutex> lock(capture->mutex);
+    while (true)
+    {
+        capture->changed.wait(lock, [capture] { return capture->quit || !capture->jobs.empty(); });
+        if (capture->jobs.empty())
+            return;
+
+        CaptureJob job = std::move(capture->jobs.front());
+        capture->jobs.pop_front();
+        capture->writing = true;
+        lock.unlock();
+
+        Zone zone("write");
+        int res = 0;
+        if (!job.filename.empty())
+        {
+            res = write_ppm(job);
+        }
+        else
+        {
+            FrameBytes yuv;
+            convert_yuv420(job.pixels.data(), job.width, job.height, true, capture->stream_width, capture->stream_height, yuv);
+            write_y4m_frame(capture->stream, yuv);
+            res = capture->stream ? 0 : -1;
+        }
+
+        lock.lock();
+        if (res < 0 && job.filename.empty() && !capture->failed)
+            std::cout << "Failed to write the recording" << std::endl;
+        if (res < 0)
+            capture->failed = true;
+        capture->writing = false;
+        capture->changed.notify_all();
+    }
+}
+
+void init_capture(Game &game)
+{
+    Capture &capture = game.capture;
+    for (CaptureSlot &slot : capture.slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        slot.size = 0;
+        slot.fence = NULL;
+    }
+    capture.worker = std::thread(capture_worker, &capture);
+}
+
+// hands the oldest slot's pixels to the writer. Without wait it gives up when
+// the GPU hasn't finished the copy yet
+bool capture_collect(Game &game, bool wait)
+{
+    Capture &capture = game.capture;
+    if (capture.in_flight == 0)
+        return false;
+
+    CaptureSlot &slot = capture.slots[capture.first];
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    glDeleteSync(slot.fence);
+    slot.fence = NULL;
+
+    // the frame is lost either way, the slot goes back for the next one
+    if (status == GL_WAIT_FAILED)
+    {
+        std::cout << "Failed to wait for a captured frame" << std::endl;
+        capture.first = (capture.first + 1) % CAPTURE_FRAMES;
+        capture.in_flight--;
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.failed = true;
+        return true;
+    }
+
+    CaptureJob job;
+    job.width = slot.width;
+    job.height = slot.height;
+    job.filename = std::move(slot.filename);
+    job.pixels.resize((size_t)slot.width * slot.height * 4);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+    if (data)
+    {
+        memcpy(job.pixels.data(), data, job.pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    capture.first = (capture.first + 1) % CAPTURE_FRAMES;
+    capture.in_flight--;
+
+    if (!data)
+    {
+        std::cout << "Failed to map a captured frame" << std::endl;
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.failed = true;
+    }
+    else
+    {
+        Zone zone("wait");
+        std::unique_lock<std::mutex> lock(capture.mutex);
+        capture.changed.wait(lock, [&capture] { return capture.jobs.size() < CAPTURE_QUEUE; });
+        capture.jobs.push_back(std::move(job));
+        capture.changed.notify_all();
+    }
+    return true;
+}
+
+// once a frame, passes on whatever the GPU has finished, oldest first
+void capture_poll(Game &game)
+{
+    while (capture_collect(game, false))
+        ;
+}
+
+// waits for everything captured so far to be written
+void capture_drain(Game &game)
+{
+    Capture &capture = game.capture;
+    while (capture_collect(game, true))
+        ;
+
+    std::unique_lock<std::mutex> lock(capture.mutex);
+    capture.changed.wait(lock, [&capture] { return capture.jobs.empty() && !capture.writing; });
+}
+
+// starts copying the framebuffer into the next pack buffer. An empty filename
+// appends the frame to the y4m recording
+void capture_frame(Game &game, std::string const &filename)
+{
+    Capture &capture = game.capture;
+    if (filename.empty() && !capture.recording)
+        return;
+
+    // every slot is busy, the oldest has had CAPTURE_FRAMES frames to finish
+    if (capture.in_flight == CAPTURE_FRAMES)
+        capture_collect(game, true);
+
+    CaptureSlot &slot = capture.slots[(capture.first + capture.in_flight) % CAPTURE_FRAMES];
+    framebuffer_size(game, slot.width, slot.height);
+    slot.filename = filename;
+
+    size_t size = (size_t)slot.width * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (size != slot.size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        slot.size = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, slot.width, slot.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    capture.in_flight++;
+}
+
+int start_recording(Game &game, char const *filename)
+{
+    Capture &capture = game.capture;
+    capture_drain(game);
+
+    capture.stream.open(filename, std::ofstream::binary | std::ofstream::trunc);
+    if (!capture.stream)
+    {
+        std::cout << "Failed to open " << filename << std::endl;
+        return -1;
+    }
+    framebuffer_size(game, capture.stream_width, capture.stream_height);
+    write_y4m_header(capture.stream, capture.stream_width, capture.stream_height);
+    capture.recording = true;
+    return 0;
+}
+
+void stop_recording(Game &game)
+{
+    Capture &capture = game.capture;
+    if (!capture.recording)
+        return;
+
+    capture_drain(game);
+    capture.stream.close();
+    capture.recording = false;
+    if (!capture.stream)
+    {
+        std::cout << "Failed to write the recording" << std::endl;
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.failed = true;
+    }
+}
+
+bool capture_failed(Capture &capture)
+{
+    std::lock_guard<std::mutex> lock(capture.mutex);
+    return capture.failed;
+}
+
+// -1 if anything captured failed to write
+int shutdown_capture(Game &game)
+{
+    Capture &capture = game.capture;
+    if (!capture.worker.joinable())
+        return 0;
+
+    stop_recording(game);
+    capture_drain(game);
+    {
+        std::lock_guard<std::mutex> lock(capture.mutex);
+        capture.quit = true;
+    }
+    capture.changed.notify_all();
+    capture.worker.join();
+    return capture.failed ? -1 : 0;
+}
+
+// the zones still in every thread's buffer as Chrome trace JSON, which
+// chrome://tracing and ui.perfetto.dev open. Times are in microseconds from
+// the oldest zone
+int write_trace(char const *filename)
+{
+    double ticks_per_us = zone_ticks_per_ms() / 1000.0;
+    TrackedVector<ZoneEvent, MEMORY_PROFILER> events;
+    std::vector<size_t> ends;
+    uint64_t first = UINT64_MAX;
+    int threads = 0;
+    for (; threads < PROFILE_THREADS; threads++)
+    {
+        ZoneBuffer const *buffer = zones.buffers[threads].load(std::memory_order_acquire);
+        if (!buffer)
+            break;
+        copy_zones(buffer, 0, events);
+        ends.push_back(events.size());
+    }
+    for (ZoneEvent const &event : events)
+        first = std::min(first, event.start);
+    if (ticks_per_us <= 0.0)
+        ticks_per_us = 1.0;
+
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::trunc);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << filename << std::endl;
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"args\": {\"name\": \"conway\"}}";
+    char line[256];
+    size_t e = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        snprintf(line, sizeof(line), ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                 pid, t, zones.buffers[t].load(std::memory_order_acquire)->name);
+        file << line;
+        for (; e < ends[t]; e++)
+        {
+            ZoneEvent const &event = events[e];
+            snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                     event.name, pid, t, (event.start - first) / ticks_per_us, (event.end - event.start) / ticks_per_us);
+            file << line;
+        }
+    }
+    file << "\n]}\n";
+    file.close();
+    if (!file)
+    {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return -1;
+    }
+
+    // stdout may be a video stream
+    std::cerr << "Wrote " << events.size() << " zones to " << filename << std::endl;
+    return 0;
+}
+
+void poll_trace(Game &game)
 {
-    unsigned int shaderProgram;
-    unsigned int VAO;
-    unsigned int color_location;
-    unsigned int offset;
+    if (!trace_requested)
+        return;
+    trace_requested = 0;
 
-    GLFWwindow *window;
+    char filename[64];
+    snprintf(filename, sizeof(filename), "conway-trace-%llu.json", (unsigned long long)game.universe.generation);
+    write_trace(filename);
+}
 
-    float accum_time;
+bool ends_with(char const *text, char const *suffix)
+{
+    size_t length = strlen(text);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && !strcmp(text + length - suffix_length, suffix);
+}
 
-    float move_rate;
+// how many %llu an --out pattern has, -1 for any other conversion. %% is fine
+int out_conversions(char const *pattern)
+{
+    int count = 0;
+    for (char const *p = pattern; *p; p++)
+    {
+        if (*p != '%')
+            continue;
+        if (p[1] == '%')
+            p++;
+        else if (!strncmp(p + 1, "llu", 3))
+        {
+            count++;
+            p += 3;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return count;
+}
 
-    struct {
-        float previous;
-        float now;
-        float delta;
-    } time;
+void report(Game &game, double seconds)
+{
+    Universe &universe = game.universe;
+    // stdout may be carrying video
+    std::ostream &out = game.options.out && !strcmp(game.options.out, "-") ? std::cerr : std::cout;
+    out << "generation " << universe.generation
+              << " population " << universe.population
+              << " " << (seconds > 0.0 ? universe.generation / seconds : 0.0) << " gens/s" << std::endl;
+}
 
-    int X;
-    int Y;
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-    float r;
-    float g;
-    float b;
-    float a;
-};
+long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
 
-void framebuffer_size_callback(GLFWwindow *window, int width, int height)
+// resident now, 0 where there's no way to ask
+long resident_kb()
 {
-    glViewport(0, 0, width, height);
+#if defined(__linux__)
+    long size, pages = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (file)
+    {
+        if (fscanf(file, "%ld %ld", &size, &pages) != 2)
+            pages = 0;
+        fclose(file);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+        return 0;
+    return (long)(info.resident_size / 1024);
+#else
+    return 0;
+#endif
 }
 
-int file_length(std::ifstream &file)
+void write_metric(std::ostream &out, char const *name, char const *type, char const *help)
 {
-    file.seekg(0, file.end);
-    int length = file.tellg();
-    file.seekg(0, file.beg);
-    return length;
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
 }
 
-unsigned int load_shader(Game &game, char const *filename, unsigned int shader_type)
+// a summary in seconds, quantiles over the last HISTOGRAM_SAMPLES samples and
+// _count and _sum over all of them
+void write_quantiles(std::ostream &out, char const *name, char const *help, Histogram const &histogram)
 {
-    std::ifstream file(filename, std::ifstream::in);
+    if (histogram.count == 0)
+        return;
+    write_metric(out, name, "summary", help);
+    for (float quantile : {0.5f, 0.95f, 0.99f})
+        out << name << "{quantile=\"" << quantile << "\"} " << histogram_percentile(histogram, quantile) / 1000.0 << "\n";
+    out << name << "{quantile=\"1\"} " << histogram_max(histogram) / 1000.0 << "\n";
+    out << name << "_sum " << histogram.total_ms / 1000.0 << "\n";
+    out << name << "_count " << histogram.total << "\n";
+}
 
-    int length = file_length(file);
+// Prometheus text exposition format, written to a temporary file and renamed
+// over options.metrics so scrapers never see half a file
+int write_metrics(Game &game, double rate)
+{
+    Universe &universe = game.universe;
+    std::ostringstream out;
 
-    char *buffer = new char[length];
-    file.read(buffer, length);
-    file.close();
+    write_metric(out, "conway_generations_total", "counter", "Generations stepped since start.");
+    out << "conway_generations_total " << universe.generation << "\n";
+    write_metric(out, "conway_generations_per_second", "gauge", "Generations stepped per second since the last write.");
+    out << "conway_generations_per_second " << rate << "\n";
+    write_metric(out, "conway_population", "gauge", "Live cells.");
+    out << "conway_population " << universe.population << "\n";
+    write_metric(out, "conway_settled", "gauge", "1 when the last generation changed nothing.");
+    out << "conway_settled " << (universe.settled ? 1 : 0) << "\n";
 
-    unsigned int shader;
-    shader = glCreateShader(shader_type);
-    glShaderSource(shader, 1, &buffer, &length);
-    glCompileShader(shader);
+    write_metric(out, "conway_memory_bytes", "gauge", "Bytes allocated by each subsystem.");
+    for (int i = 0; i < MEMORY_SUBSYSTEMS; i++)
+        out << "conway_memory_bytes{subsystem=\"" << MEMORY_SUBSYSTEM_NAMES[i] << "\"} " << memory_counters[i].live.load() << "\n";
+    write_metric(out, "conway_memory_peak_bytes", "gauge", "Most bytes each subsystem has had allocated at once.");
+    for (int i = 0; i < MEMORY_SUBSYSTEMS; i++)
+        out << "conway_memory_peak_bytes{subsystem=\"" << MEMORY_SUBSYSTEM_NAMES[i] << "\"} " << memory_counters[i].peak.load() << "\n";
+    write_metric(out, "conway_peak_resident_bytes", "gauge", "Peak resident set size of the process.");
+    out << "conway_peak_resident_bytes " << peak_rss_kb() * 1024 << "\n";
 
-    int success;
-    char infoLog[MAX_INFO_LOG];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    write_quantiles(out, "conway_frame_seconds", "Time between presented frames.", game.histograms.frame);
+    write_quantiles(out, "conway_step_seconds", "Time spent stepping per frame.", game.histograms.step);
+    write_quantiles(out, "conway_input_latency_seconds", "Estimated input to photon latency.", game.histograms.latency);
+
+    std::string path = game.options.metrics;
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ofstream::out | std::ofstream::trunc);
+    file << out.str();
+    file.close();
+    if (!file || rename(temporary.c_str(), path.c_str()) != 0)
     {
-        glGetShaderInfoLog(shader, MAX_INFO_LOG, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        std::cerr << "Failed to write " << path << std::endl;
+        remove(temporary.c_str());
         return -1;
     }
+    return 0;
+}
 
-    delete[] buffer;
+// rewrites the metrics once METRICS_INTERVAL has passed on the caller's clock
+void poll_metrics(Game &game, double now)
+{
+    if (!game.options.metrics || now - game.metrics_time < METRICS_INTERVAL)
+        return;
 
-    return shader;
+    double rate = (game.universe.generation - game.metrics_generation) / (now - game.metrics_time);
+    write_metrics(game, rate);
+    game.metrics_time = now;
+    game.metrics_generation = game.universe.generation;
 }
 
-int setup_shaders(Game &game)
+// steps the universe without any GL, for machines with neither a display nor a GPU
+int run_headless(Game &game)
 {
-    // create shaders
-    unsigned int vertex_shader = load_shader(game, "shader/vertex.glsl", GL_VERTEX_SHADER);
-    if (vertex_shader < 0)
-        return vertex_shader;
+    Options &options = game.options;
+    Universe &universe = game.universe;
 
-    unsigned int fragment_shader = load_shader(game, "shader/fragment.glsl", GL_FRAGMENT_SHADER);
-    if (fragment_shader < 0)
-        return fragment_shader;
+    auto start = std::chrono::steady_clock::now();
+    bool reported = false;
+    while (options.generations == 0 || universe.generation < options.generations)
+    {
+        {
+            Zone zone("step");
+            step_universe(universe, NULL, &game.pool);
+        }
+        poll_trace(game);
+        poll_metrics(game, seconds_since(start));
 
-    game.shaderProgram = glCreateProgram();
-    glAttachShader(game.shaderProgram, vertex_shader);
-    glAttachShader(game.shaderProgram, fragment_shader);
-    glLinkProgram(game.shaderProgram);
+        reported = options.every && universe.generation % options.every == 0;
+        if (reported)
+            report(game, seconds_since(start));
+    }
+    stop_pool(game.pool);
+    if (!reported)
+        report(game, seconds_since(start));
 
-    int success;
-    char infoLog[MAX_INFO_LOG];
-    glGetProgramiv(game.shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
+    return 0;
+}
+
+void render_video_frame(RasterView const &view, VideoFrame &frame)
+{
+    TrackedVector<uint32_t, MEMORY_CAPTURE> pixels((size_t)view.width * view.height);
+    rasterize_rows(view, frame.texels.data(), 0, view.height, pixels.data());
+    convert_yuv420((uint8_t const *)pixels.data(), view.width, view.height, false, view.width, view.height, frame.yuv);
+    frame.done.store(true, std::memory_order_release);
+}
+
+// steps without GL and shades every Nth generation on the CPU into a y4m
+// stream. Frames are shaded on the pool, several at once, while the universe
+// keeps stepping on the same pool, and written in order. At most two per
+// thread are in flight, after that stepping waits for the oldest
+int run_video(Game &game)
+{
+    Options &options = game.options;
+    Universe &universe = game.universe;
+    uint64_t every = options.every ? options.every : 1;
+
+    std::ofstream file;
+    std::ostream *out = &std::cout;
+    if (strcmp(options.out, "-"))
     {
-        glGetProgramInfoLog(game.shaderProgram, MAX_INFO_LOG, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        file.open(options.out, std::ofstream::binary | std::ofstream::trunc);
+        if (!file)
+        {
+            std::cout << "Failed to open " << options.out << std::endl;
+            stop_pool(game.pool);
+            return -1;
+        }
+        out = &file;
     }
 
-    game.color_location = glGetUniformLocation(game.shaderProgram, "ourColor");
-    game.offset = glGetUniformLocation(game.shaderProgram, "offset");
+    // the camera doesn't move, so neither does what each pixel shows
+    fit_camera(game);
+    RasterView view;
+    make_raster_view(game, game.X, game.Y, view);
+    write_y4m_header(*out, game.X, game.Y);
 
-    // delete shaders once they are linked, we don't need them anymore
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    ThreadPool &pool = game.pool;
+    size_t limit = 2 * pool.threads.size();
+    std::deque<VideoFrame> frames;
 
-    return 0;
+    auto write_oldest = [&]()
+    {
+        VideoFrame &oldest = frames.front();
+        pool_wait(pool, [&oldest] { return oldest.done.load(std::memory_order_acquire); });
+        Zone zone("write");
+        write_y4m_frame(*out, oldest.yuv);
+        frames.pop_front();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    double last_report = 0.0;
+    while (options.generations == 0 || universe.generation < options.generations)
+    {
+        poll_trace(game);
+        poll_metrics(game, seconds_since(start));
+        if ((universe.generation + 1) % every != 0)
+        {
+            Zone zone("step");
+            step_universe(universe, NULL, &pool);
+            continue;
+        }
+
+        if (frames.size() == limit)
+            write_oldest();
+
+        // the step writes the frame's texels while the rows are in cache
+        frames.emplace_back();
+        VideoFrame &frame = frames.back();
+        frame.texels.resize(2 * (size_t)view.region.width * view.region.height);
+        Texels texels = Texels{view.region, frame.texels.data(), 0};
+        {
+            Zone zone("step");
+            step_universe(universe, &texels, &pool);
+        }
+        pool_submit(pool, [&view, &frame]
+        {
+            Zone zone("shade");
+            render_video_frame(view, frame);
+        });
+
+        double seconds = seconds_since(start);
+        if (seconds - last_report >= 1.0)
+        {
+            report(game, seconds);
+            last_report = seconds;
+        }
+    }
+    while (!frames.empty())
+        write_oldest();
+    stop_pool(pool);
+    out->flush();
+    report(game, seconds_since(start));
+
+    return *out ? 0 : -1;
 }
 
-int init_gl(Game &game)
+// steps and renders into an offscreen framebuffer, writing frames as PPM
+int run_offscreen(Game &game)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    Options &options = game.options;
+    Universe &universe = game.universe;
 
-    game.window = glfwCreateWindow(game.X, game.Y, "conway", NULL, NULL);
-    if (game.window == NULL)
+    int res = init_offscreen_gl(game);
+    if (res < 0)
+        return res;
+
+    res = setup_shaders(game);
+    if (res < 0)
+        return res;
+
+    res = setup_render(game);
+    if (res < 0)
+        return res;
+
+    fit_camera(game);
+    init_capture(game);
+
+    // a .y4m gets every rendered frame, otherwise without an output pattern only
+    // the last frame is written
+    bool video = options.out && ends_with(options.out, ".y4m");
+    bool sequence = options.out && out_conversions(options.out) == 1;
+    char filename[1024];
+
+    if (video && start_recording(game, options.out) < 0)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+        shutdown_capture(game);
         return -1;
     }
-    glfwMakeContextCurrent(game.window);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    auto start = std::chrono::steady_clock::now();
+    bool reported = false;
+    do
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // whether the generation about to be computed gets rendered
+        bool frame = options.every && (universe.generation + 1) % options.every == 0;
+        bool last = universe.generation + 1 >= options.generations;
+
+        plan_frame(game);
+        Texels *texels = frame || last ? begin_fused_step(game) : NULL;
+        {
+            Zone zone("step");
+            step_universe(universe, texels);
+        }
+        end_fused_step(game, texels);
+        poll_trace(game);
+        poll_metrics(game, seconds_since(start));
+
+        if (frame || last)
+        {
+            renderWindow(game);
+
+            if (video)
+            {
+                capture_frame(game, "");
+            }
+            else if (options.out && (sequence || last))
+            {
+                snprintf(filename, sizeof(filename), options.out, (unsigned long long)universe.generation);
+                capture_frame(game, filename);
+            }
+            capture_poll(game);
+        }
+
+        reported = frame;
+        if (reported)
+            report(game, seconds_since(start));
+    } while (universe.generation < options.generations);
+    res = shutdown_capture(game);
+    stop_pool(game.pool);
+    if (!reported)
+        report(game, seconds_since(start));
+
+    return res;
+}
+
+// sets the cells of an RLE pattern (b dead, o alive, $ next row, ! end) with
+// its top left corner at x, y, wrapping around the edges
+void place_rle(Universe &universe, char const *rle, int x, int y)
+{
+    int cx = 0, cy = 0, count = 0;
+    for (char const *p = rle; *p && *p != '!'; p++)
+    {
+        if (*p >= '0' && *p <= '9')
+        {
+            count = count * 10 + (*p - '0');
+            continue;
+        }
+
+        int n = count ? count : 1;
+        count = 0;
+        if (*p == 'b')
+        {
+            cx += n;
+        }
+        else if (*p == 'o')
+        {
+            for (int i = 0; i < n; i++, cx++)
+            {
+                size_t cell = (size_t)((y + cy) % universe.height) * universe.width + (x + cx) % universe.width;
+                universe.population += !universe.cells[cell];
+                universe.cells[cell] = 1;
+                universe.age[cell] = 1;
+            }
+        }
+        else if (*p == '$')
+        {
+            cy += n;
+            cx = 0;
+        }
+    }
+}
+
+enum BenchEngine
+{
+    BENCH_SCALAR,
+    BENCH_VECTOR,
+    BENCH_THREADED,
+};
+
+static char const *const BENCH_ENGINE_NAMES[] = {"scalar", "vector", "threaded"};
+
+// random soups, or an RLE pattern placed once in the middle or tiled every
+// spacing cells
+struct BenchPattern
+{
+    char const *name;
+    float density;
+    char const *rle;
+    int spacing_x;
+    int spacing_y;
+};
+
+static const BenchPattern BENCH_PATTERNS[] = {
+    {"soup 10%", 0.10f, NULL, 0, 0},
+    {"soup 25%", 0.25f, NULL, 0, 0},
+    {"soup 50%", 0.50f, NULL, 0, 0},
+    {"gosper gun array", 0.0f, "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!", 64, 48},
+    // the smallest pattern that grows forever, a block laying switch engine
+    {"switch engine", 0.0f, "6bo$4bob2o$4bobo$4bo$2bo$obo!", 0, 0},
+    {"r-pentomino", 0.0f, "b2o$2o$bo!", 0, 0},
+};
+
+static const int BENCH_SIZES[] = {256, 1024, 4096, 16384, 65536};
+
+void seed_bench(Universe &universe, BenchPattern const &pattern, int size, ThreadPool *pool = NULL)
+{
+    init_universe(universe, size, size);
+    if (pool)
+        touch_universe(universe, *pool);
+    if (!pattern.rle)
+    {
+        seed_universe(universe, pattern.density, 1);
+        return;
     }
 
-    glfwSetFramebufferSizeCallback(game.window, framebuffer_size_callback);
+    if (!pattern.spacing_x)
+    {
+        place_rle(universe, pattern.rle, size / 2, size / 2);
+        return;
+    }
+    for (int y = 0; y + pattern.spacing_y <= size; y += pattern.spacing_y)
+        for (int x = 0; x + pattern.spacing_x <= size; x += pattern.spacing_x)
+            place_rle(universe, pattern.rle, x, y);
+}
 
-    glViewport(0, 0, game.X, game.Y);
+// steps until at least seconds have passed, after one untimed generation to
+// warm the caches. Returns the seconds taken
+double bench_engine(Universe &universe, int engine, ThreadPool &pool, double seconds, uint64_t &generations)
+{
+    if (engine == BENCH_SCALAR)
+        step_universe_scalar(universe);
+    else
+        step_universe(universe, NULL, engine == BENCH_THREADED ? &pool : NULL);
 
-    // this is a stupid workaround around a bug in Mojave. Figure out why this sucks'
-    // https://stackoverflow.com/questions/52509427/mac-mojave-opengl
-    glfwSetWindowSize(game.window, game.X - 1, game.Y);
-    glfwPollEvents();
-    glfwSetWindowSize(game.window, game.X, game.Y);
+    generations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do
+    {
+        if (engine == BENCH_SCALAR)
+            step_universe_scalar(universe);
+        else
+            step_universe(universe, NULL, engine == BENCH_THREADED ? &pool : NULL);
+        generations++;
+        elapsed = seconds_since(start);
+    } while (elapsed < seconds);
+    return elapsed;
+}
+
+// every engine over every pattern and size, the threaded engine at 2, 4, ...
+// threads up to the core count. Speedups are against the vector engine on
+// one thread
+int run_bench(Game &game)
+{
+    Options &options = game.options;
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<int> thread_counts;
+    for (int threads = 2; threads < cores; threads *= 2)
+        thread_counts.push_back(threads);
+    if (cores > 1)
+        thread_counts.push_back(cores);
+
+    std::cout << "{\n  \"cores\": " << cores << ",\n  \"numa_nodes\": " << std::max<size_t>(1, read_numa_nodes().size())
+              << ",\n  \"results\": [";
+    char const *separator = "\n";
+
+    Universe universe;
+    ThreadPool pool{};
+    for (int size : BENCH_SIZES)
+    {
+        if (size > options.bench_max)
+            continue;
+
+        for (BenchPattern const &pattern : BENCH_PATTERNS)
+        {
+            // vector first, so there's something to compare the others against
+            double single = 0.0;
+            int runs = BENCH_THREADED + (int)thread_counts.size();
+            for (int run = 0; run < runs; run++)
+            {
+                int engine = run == 0 ? BENCH_VECTOR : run == 1 ? BENCH_SCALAR : BENCH_THREADED;
+                int threads = engine == BENCH_THREADED ? thread_counts[run - BENCH_THREADED] : 1;
+
+                // what the run holds is measured from a process without the
+                // last run's universe, the peak never comes down
+                universe = Universe();
+                long resident = resident_kb();
+
+                // the threaded engine's planes are placed by a pool pinned
+                // like the one that steps them
+                if (engine == BENCH_THREADED)
+                {
+                    start_pool(pool, threads, true);
+                    seed_bench(universe, pattern, size, &pool);
+                    stop_pool(pool);
+                }
+                else
+                {
+                    seed_bench(universe, pattern, size);
+                }
+
+                // the counters are opened before the workers start so they
+                // count them too, and read once the workers are gone
+                PerfCounters perf;
+                open_perf_counters(perf, true);
+                if (engine == BENCH_THREADED)
+                    start_pool(pool, threads, true);
+
+                uint64_t generations;
+                double seconds = bench_engine(universe, engine, pool, options.bench_seconds, generations);
+                long rss = resident_kb() - resident;
+
+                if (engine == BENCH_THREADED)
+                    stop_pool(pool);
+                uint64_t counts[PERF_COUNTERS];
+                read_perf_counters(perf, counts);
+                close_perf_counters(perf);
+
+                double ns = seconds * 1e9 / generations;
+                if (engine == BENCH_VECTOR)
+                    single = ns;
+
+                // the counts include the warm-up generation
+                char counters[256] = "null";
+                if (counts[PERF_CYCLES])
+                {
+                    double per_generation = 1.0 / (generations + 1);
+                    snprintf(counters, sizeof(counters),
+                             "{\"ipc\": %.2f, \"llc_misses_per_generation\": %.0f, \"branch_misses_per_generation\": %.0f, "
+                             "\"bandwidth_gb_per_second\": %.2f}",
+                             (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES],
+                             counts[PERF_LLC_MISSES] * per_generation, counts[PERF_BRANCH_MISSES] * per_generation,
+                             counts[PERF_LLC_MISSES] * per_generation * CACHE_LINE / ns);
+                }
+
+                char line[768];
+                snprintf(line, sizeof(line),
+                         "    {\"engine\": \"%s\", \"pattern\": \"%s\", \"size\": %d, \"threads\": %d, "
+                         "\"generations\": %llu, \"ns_per_generation\": %.0f, \"cell_updates_per_second\": %.4g, "
+                         "\"speedup\": %.2f, \"rss_kb\": %ld, \"counters\": %s}",
+                         BENCH_ENGINE_NAMES[engine], pattern.name, size, threads,
+                         (unsigned long long)generations, ns, (double)size * size * 1e9 / ns,
+                         single / ns, rss, counters);
+                std::cout << separator << line << std::flush;
+                separator = ",\n";
+            }
+        }
+    }
+    std::cout << "\n  ]\n}" << std::endl;
 
     return 0;
 }
 
-void processInput(Game &game)
+uint64_t hash_region(Universe const &universe, Region region)
 {
-    if (glfwGetKey(game.window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(game.window, true);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int y = region.y; y < region.y + region.height; y++)
+    {
+        size_t offset = (size_t)y * universe.width + region.x;
+        hash = fnv1a(hash, (char const *)universe.cells.data() + offset, region.width);
+        hash = fnv1a(hash, (char const *)universe.age.data() + offset, region.width);
+    }
+    return hash;
+}
 
-    double xpos, ypos;
-    glfwGetCursorPos(game.window, &xpos, &ypos);
+// halves the region down to a tile, keeping a half whose hash differs, and
+// prints the first cell in it that doesn't match
+void report_divergence(Universe const &reference, Universe const &universe, char const *engine)
+{
+    Region region = Region{0, 0, universe.width, universe.height};
+    while (region.width > TILE_SIZE || region.height > TILE_SIZE)
+    {
+        Region first = region;
+        Region second = region;
+        if (region.width >= region.height)
+        {
+            first.width /= 2;
+            second.x += first.width;
+            second.width -= first.width;
+        }
+        else
+        {
+            first.height /= 2;
+            second.y += first.height;
+            second.height -= first.height;
+        }
+        region = hash_region(reference, first) != hash_region(universe, first) ? first : second;
+    }
+
+    std::cout << engine << " diverged at generation " << universe.generation
+              << " in the tile at " << region.x << "," << region.y << std::endl;
+    for (int y = region.y; y < region.y + region.height; y++)
+        for (int x = region.x; x < region.x + region.width; x++)
+        {
+            size_t cell = (size_t)y * universe.width + x;
+            if (reference.cells[cell] == universe.cells[cell] && reference.age[cell] == universe.age[cell])
+                continue;
+            std::cout << "first at " << x << "," << y
+                      << ": alive " << (int)universe.cells[cell] << " age " << (int)universe.age[cell]
+                      << ", reference alive " << (int)reference.cells[cell] << " age " << (int)reference.age[cell] << std::endl;
+            return;
+        }
+    std::cout << "cells match, population " << universe.population << " vs " << reference.population
+              << ", settled " << universe.settled << " vs " << reference.settled << std::endl;
+}
+
+// steps the scalar reference engine, the vector engine, the vector engine
+// banded over a pool and the vector engine writing display texels from the
+// same seed, comparing hashes of every one against the reference each
+// generation. Runs once with ages held and once with trails decaying
+int run_crosscheck(Game &game)
+{
+    Options &options = game.options;
+    uint64_t generations = options.generations ? options.generations : 1000;
+    enum { VECTOR, THREADED, FUSED, ENGINES };
+    char const *const names[ENGINES] = {"vector", "threaded", "fused"};
+
+    // at least two threads, or the threaded step doesn't split into bands
+    ThreadPool pool{};
+    start_pool(pool, options.threads > 1 ? options.threads : 3);
+
+    Universe reference;
+    Universe universes[ENGINES];
+    std::vector<uint8_t> texels;
+    std::vector<uint8_t> expected;
+    Region all = Region{0, 0, options.width, options.height};
+    int failed = 0;
+    for (int decay : {255, 16})
+    {
+        init_universe(reference, options.width, options.height);
+        seed_universe(reference, options.density, options.seed);
+        reference.decay = (uint8_t)decay;
+        for (Universe &universe : universes)
+            universe = reference;
+
+        for (uint64_t g = 0; g < generations && !failed; g++)
+        {
+            step_universe_scalar(reference);
+            step_universe(universes[VECTOR]);
+            step_universe(universes[THREADED], NULL, &pool);
+
+            texels.resize(2 * (size_t)all.width * all.height);
+            Texels fused = Texels{all, texels.data(), 0};
+            step_universe(universes[FUSED], &fused);
+
+            uint64_t hash = hash_region(reference, all);
+            for (int e = 0; e < ENGINES; e++)
+            {
+                Universe const &universe = universes[e];
+                if (hash_region(universe, all) != hash || universe.population != reference.population || universe.settled != reference.settled)
+                {
+                    report_divergence(reference, universe, names[e]);
+                    failed = 1;
+                }
+            }
 
-    game.r = std::clamp(xpos / game.X, 0.0, 1.0);
-    game.g = std::clamp(ypos / game.Y, 0.0, 1.0);
+            expected.resize(texels.size());
+            size_t visible = read_region(reference, all, expected.data());
+            if (!failed && (texels != expected || fused.visible != visible))
+            {
+                size_t first = std::mismatch(texels.begin(), texels.end(), expected.begin()).first - texels.begin();
+                std::cout << "fused texels diverged at generation " << reference.generation
+                          << ", first at " << first / 2 % all.width << "," << first / 2 / all.width
+                          << ", " << fused.visible << " visible vs " << visible << std::endl;
+                failed = 1;
+            }
+        }
+        if (failed)
+            break;
+        std::cout << "decay " << decay << ": " << generations << " generations match, population " << reference.population << std::endl;
+    }
+    stop_pool(pool);
 
-    // std::cout << "xpos: " << xpos << " ypos: " << ypos << std::endl;
-    // std::cout << "r: " << game->r << " g: " << game->g << " b: " << game->b << std::endl;
+    return failed ? -1 : 0;
 }
 
-void renderWindow(Game &game)
+void usage(char const *name)
 {
-    glUseProgram(game.shaderProgram);
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --headless          step the universe without GL\n"
+              << "  --offscreen         render through an offscreen GL context, no window\n"
+              << "  --size WxH          universe size in cells (512x512)\n"
+              << "  --density D         initial live cell density (0.25)\n"
+              << "  --seed N            random seed (1)\n"
+              << "  --generations N     stop after N generations, headless and offscreen only\n"
+              << "  --every N           report and render every N generations\n"
+              << "  --out FILE.ppm      write the last frame, or every frame if FILE has a %llu\n"
+              << "  --out FILE.y4m      write every rendered frame into one video, with --headless\n"
+              << "                      frames are shaded on the CPU and - writes to stdout\n"
+              << "  --metrics FILE      keep FILE updated with Prometheus text metrics every second\n"
+              << "  --threads N         threads stepping headless runs and shading video or cpu frames, 0 = one per core (0)\n"
+              << "  --render MODE       auto, texture, instanced or cpu (auto)\n"
+              << "  --crosscheck        step every engine from the same seed, stop at the first difference\n"
+              << "  --bench             benchmark the engines and print the results as JSON\n"
+              << "  --bench-max N       largest benchmark universe, NxN cells (4096)\n"
+              << "  --bench-time S      seconds per benchmark run (0.25)\n"
+              << "  --frame WxH         offscreen frame size (800x600)\n"
+              << "\n"
+              << "F12 or SIGUSR2 writes the last few thousand zones of every thread to\n"
+              << "conway-trace-<generation>.json, for chrome://tracing or ui.perfetto.dev" << std::endl;
+}
 
-    // glClearColor(0.8f, 0.0f, 0.4f, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+bool parse_render_mode(char const *value, int &mode)
+{
+    static char const *const names[] = {"auto", "texture", "instanced", "cpu"};
+    for (int i = 0; i < IM_ARRAYSIZE(names); i++)
+    {
+        if (!strcmp(value, names[i]))
+        {
+            mode = i;
+            return true;
+        }
+    }
+    return false;
+}
 
-    glBindVertexArray(game.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    glDrawArrays(GL_TRIANGLES, 6, 3);
-    // glDrawArrays(GL_TRIANGLES, 12, 3);
-    // glDrawArrays(GL_TRIANGLES, 18, 3);
-    // glDrawArrays(GL_TRIANGLES, 24, 3);
+int parse_options(Game &game, int argc, char **argv)
+{
+    Options &options = game.options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        char const *arg = argv[i];
+
+        if (!strcmp(arg, "--headless"))
+        {
+            options.headless = true;
+            continue;
+        }
+        if (!strcmp(arg, "--offscreen"))
+        {
+            options.offscreen = true;
+            continue;
+        }
+        if (!strcmp(arg, "--crosscheck"))
+        {
+            options.crosscheck = true;
+            continue;
+        }
+        if (!strcmp(arg, "--bench"))
+        {
+            options.bench = true;
+            continue;
+        }
 
-    glUniform4f(game.color_location, game.r, game.g, 0.0f, 0.0f);
-    game.accum_time += game.time.delta;
-    glUniform3f(game.offset, (sin(game.accum_time * game.move_rate) / 2.0f) , 0.0f, 0.0f);
+        // everything else takes a value
+        char const *value = ++i < argc ? argv[i] : NULL;
+        bool ok = true;
+
+        if (!value)
+            ok = false;
+        else if (!strcmp(arg, "--size"))
+            ok = sscanf(value, "%dx%d", &options.width, &options.height) == 2;
+        else if (!strcmp(arg, "--frame"))
+            ok = sscanf(value, "%dx%d", &game.X, &game.Y) == 2;
+        else if (!strcmp(arg, "--density"))
+            options.density = strtof(value, NULL);
+        else if (!strcmp(arg, "--seed"))
+            options.seed = (unsigned int)strtoul(value, NULL, 10);
+        else if (!strcmp(arg, "--generations"))
+            options.generations = strtoull(value, NULL, 10);
+        else if (!strcmp(arg, "--every"))
+            options.every = strtoull(value, NULL, 10);
+        else if (!strcmp(arg, "--out"))
+        {
+            // the pattern goes to snprintf, so only one %llu and nothing else
+            options.out = value;
+            int conversions = out_conversions(value);
+            ok = conversions == 0 || conversions == 1;
+        }
+        else if (!strcmp(arg, "--metrics"))
+            options.metrics = value;
+        else if (!strcmp(arg, "--threads"))
+            options.threads = atoi(value);
+        else if (!strcmp(arg, "--render"))
+            ok = parse_render_mode(value, game.render.mode);
+        else if (!strcmp(arg, "--bench-max"))
+            options.bench_max = atoi(value);
+        else if (!strcmp(arg, "--bench-time"))
+            options.bench_seconds = atof(value);
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (options.width <= 0 || options.height <= 0 || game.X <= 0 || game.Y <= 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    // without a window there's nothing to close, so something has to stop the run
+    if (options.offscreen && options.generations == 0)
+        options.generations = 1;
+
+    return 0;
 }
 
-int main()
+int main(int argc, char **argv)
 {
-    Game game = Game{.X = 800, .Y = 600, .a = 1};
+    Game game = Game{.X = 800, .Y = 600, .r = 1, .g = 1, .b = 1, .a = 1};
+    game.options.width = 512;
+    game.options.height = 512;
+    game.options.density = 0.25f;
+    game.options.seed = 1;
+    game.options.bench_max = 4096;
+    game.options.bench_seconds = 0.25;
+    game.render.color_mode = COLOR_AGE;
+    game.render.trail_length = 16;
+    game.render.fused = true;
+    game.render.imgui_ring = true;
+    game.idle = true;
+    game.redraw = IDLE_FRAMES;
+    game.schedule.mode = SCHEDULE_BUDGET;
+    game.schedule.budget_ms = 12.0f;
+    game.schedule.target_rate = 60.0f;
+    game.schedule.present_every = 8;
+    game.profile.selected = -1;
 
-    if (int res = init_gl(game) < 0)
+    if (int res = parse_options(game, argc, argv) < 0)
         return res;
 
-    if (int res = setup_shaders(game) < 0)
-        return res;
+    name_thread("main");
+    signal(SIGUSR2, request_trace);
 
-    glGenVertexArrays(1, &game.VAO);
+    if (game.options.bench)
+        return run_bench(game) < 0;
 
-    glBindVertexArray(game.VAO);
+    if (game.options.crosscheck)
+        return run_crosscheck(game) < 0;
 
-    float vertices[] = {
-        0.2f, -0.2f, 0.0f, 1.0f, 0.0f, 0.0f,  // bottom right
-        -0.2f, -0.2f, 0.0f, 0.0f, 1.0f, 0.0f, // bottom left
-        0.0f, 0.2f, 0.0f, 0.0f, 0.0f, 1.0f,   // top
-    };
+    // headless runs step on a pool pinned across the NUMA nodes, which has to
+    // touch the planes before seeding writes them
+    game.seed_density = game.options.density;
+    init_universe(game.universe, game.options.width, game.options.height);
+    if (game.options.headless)
+    {
+        start_pool(game.pool, game.options.threads, true);
+        touch_universe(game.universe, game.pool);
+    }
+    seed_universe(game.universe, game.seed_density, game.options.seed);
 
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (game.options.headless && game.options.out)
+        return run_video(game) < 0;
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    if (game.options.headless)
+        return run_headless(game) < 0;
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    if (game.options.offscreen)
+        return run_offscreen(game) < 0;
+
+    if (int res = init_gl(game) < 0)
+        return res;
+
+    // latency counts one refresh for the frame to be scanned out. Remote
+    // sessions may have no monitor at all, those get 60 Hz
+    GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+    GLFWvidmode const *video_mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+    game.time.refresh = video_mode && video_mode->refreshRate > 0 ? 1.0 / video_mode->refreshRate : 1.0 / 60.0;
+
+    if (int res = setup_shaders(game) < 0)
+        return res;
+
+    if (int res = setup_render(game) < 0)
+        return res;
+
+    fit_camera(game);
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(ui_alloc, ui_free);
     ImGui::CreateContext();
+    install_font_atlas(ImGui::GetIO().Fonts);
+    init_capture(game);
 
     // Setup Platform/Renderer bindings
-    ImGui_ImplGlfw_InitForOpenGL(game.window, true);
+    ImGui_ImplGlfw_InitForOpenGL(game.window, false);
     ImGui_ImplOpenGL3_Init("#version 330");
 
+    install_callbacks(game);
+    open_perf_counters(game.perf, false);
+
     game.time.previous = glfwGetTime();
     while (!glfwWindowShouldClose(game.window))
     {
+        // idle waits time out every second, so this keeps up even then
+        poll_metrics(game, glfwGetTime());
+
+        if (can_idle(game))
+        {
+            glfwWaitEventsTimeout(IDLE_TIMEOUT);
+            game.time.previous = glfwGetTime();
+            game.time.presented = game.time.previous;
+            if (game.redraw == 0)
+                continue;
+        }
+        else if (game.redraw > 0)
+        {
+            game.redraw--;
+        }
+        begin_profile_frame(game);
+
         // common part, do this only once
         game.time.now = glfwGetTime();
         game.time.delta = game.time.now - game.time.previous;
         game.time.previous = game.time.now;
+        game.accum_time += game.time.delta;
 
         processInput(game);
 
+        plan_frame(game);
+
+        Scheduler &schedule = game.schedule;
+        bool present = schedule.mode != SCHEDULE_TURBO || game.paused || ++schedule.skipped >= schedule.present_every;
+        run_steps(game, plan_steps(game), present);
+        measure_rate(game);
+        if (!present)
+        {
+            glfwPollEvents();
+            end_profile_frame(game);
+            continue;
+        }
+        schedule.skipped = 0;
+
         renderWindow(game);
 
-        glfwPollEvents();
+        // the cells and overlay without the UI on top
+        char filename[64];
+        {
+            Zone zone("capture");
+            if (game.capture.screenshot)
+            {
+                snprintf(filename, sizeof(filename), "conway-%llu.ppm", (unsigned long long)game.universe.generation);
+                capture_frame(game, filename);
+                game.capture.screenshot = false;
+            }
+            capture_frame(game, "");
+            capture_poll(game);
+        }
+
+        {
+            Zone zone("events");
+            glfwPollEvents();
+        }
 
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -256,15 +4351,145 @@ int main()
 
         ImGui::Begin("Triangle Shit");
 
-            ImGui::SliderFloat("move rate", &game.move_rate, 0.0f, 5.0f, "%.3f");
+            Universe &universe = game.universe;
+            ImGui::Text("generation %llu, population %zu%s", (unsigned long long)universe.generation, universe.population, universe.settled ? ", settled" : "");
+            ImGui::Checkbox("paused", &game.paused);
+            ImGui::SameLine();
+            ImGui::Checkbox("idle when nothing changes", &game.idle);
+            if (ImGui::Button("step"))
+                step_universe(universe);
+
+            ImGui::Combo("schedule", &schedule.mode, "one generation per frame\0frame budget\0turbo\0");
+            if (schedule.mode != SCHEDULE_FRAME)
+                ImGui::SliderFloat("budget", &schedule.budget_ms, 1.0f, 33.0f, "%.1f ms");
+            if (schedule.mode == SCHEDULE_BUDGET)
+                ImGui::SliderFloat("target gens/s", &schedule.target_rate, 0.0f, 100000.0f, schedule.target_rate > 0.0f ? "%.0f" : "unlimited", 4.0f);
+            if (schedule.mode == SCHEDULE_TURBO)
+                ImGui::SliderInt("draw every", &schedule.present_every, 1, 64, "%d frames");
+            ImGui::Text("%d generations this frame, %.3f ms each, %.0f gens/s", schedule.batch, schedule.step_ms, schedule.rate);
+            if (ImGui::CollapsingHeader("Step counters"))
+            {
+                float const *counts = game.perf.per_generation;
+                if (!game.perf.open)
+                {
+                    ImGui::TextDisabled("no hardware counters, they need Linux and perf_event_paranoid <= 2");
+                }
+                else
+                {
+                    // a low IPC with a high miss rate means the step is waiting on memory
+                    size_t cells = (size_t)universe.width * universe.height;
+                    ImGui::Text("IPC %.2f", counts[PERF_CYCLES] > 0.0f ? counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES] : 0.0f);
+                    ImGui::Text("LLC misses %.0f per generation, %.4f per cell", counts[PERF_LLC_MISSES], counts[PERF_LLC_MISSES] / cells);
+                    ImGui::Text("branch misses %.0f per generation", counts[PERF_BRANCH_MISSES]);
+                    ImGui::Text("~%.2f GB/s from memory", schedule.step_ms > 0.0f ? counts[PERF_LLC_MISSES] * CACHE_LINE / (schedule.step_ms * 1e6f) : 0.0f);
+                }
+            }
+
+            ImGui::SliderFloat("density", &game.seed_density, 0.0f, 1.0f, "%.3f");
+            if (ImGui::Button("reseed"))
+                seed_universe(universe, game.seed_density, (unsigned int)universe.generation + 1);
+
+            ImGui::Combo("render mode", &game.render.mode, "auto\0texture\0instanced\0cpu\0");
+            ImGui::Checkbox("fused step and upload", &game.render.fused);
+            ImGui::Combo("colors", &game.render.color_mode, "plain\0age\0trail\0");
+            if (game.render.color_mode == COLOR_TRAIL)
+                ImGui::SliderInt("trail length", &game.render.trail_length, 1, 255);
+            uint8_t decay = game.render.color_mode == COLOR_TRAIL ? (uint8_t)(255 / game.render.trail_length) : 255;
+            if (decay != universe.decay)
+                universe.settled = false;
+            universe.decay = decay;
+            ImGui::Text("drawing %s, %.1f%% live", game.render.mode == RENDER_CPU ? "on the cpu" : game.render.instanced ? "instanced" : "texture", game.render.density * 100.0f);
+
+            Region &region = game.render.region;
+            ImGui::Text("reading %dx%d cells at %d,%d", region.width, region.height, region.x, region.y);
+            ImGui::Text("zoom %.2f", game.camera.zoom);
+            if (ImGui::Button("fit view"))
+                fit_camera(game);
+
+            if (game.hovering)
+                ImGui::Text("cell %d,%d", game.hover_x, game.hover_y);
+            if (game.selection.active)
+                ImGui::Text("selected %dx%d", std::abs(game.selection.x1 - game.selection.x0) + 1, std::abs(game.selection.y1 - game.selection.y0) + 1);
+
+            if (ImGui::CollapsingHeader("GPU time", ImGuiTreeNodeFlags_DefaultOpen))
+            {
+                float total = 0.0f;
+                for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+                {
+                    ImGui::Text("%-8s %6.3f ms", GPU_PASS_NAMES[pass], game.gpu.ms[pass]);
+                    total += game.gpu.ms[pass];
+                }
+                ImGui::Text("%-8s %6.3f ms", "total", total);
+                ImGui::Checkbox("ring buffered imgui", &game.render.imgui_ring);
+            }
+
+            if (ImGui::CollapsingHeader("CPU time"))
+                draw_profile(game);
+
+            if (ImGui::CollapsingHeader("Memory"))
+            {
+                ImGui::Text("%-10s %10s %10s", "", "live", "peak");
+                for (int i = 0; i < MEMORY_SUBSYSTEMS; i++)
+                    ImGui::Text("%-10s %7.1f MB %7.1f MB", MEMORY_SUBSYSTEM_NAMES[i],
+                                memory_counters[i].live.load() / 1048576.0, memory_counters[i].peak.load() / 1048576.0);
+                ImGui::Text("%-10s %10s %7.1f MB", "process", "", peak_rss_kb() / 1024.0);
+            }
+
+            if (ImGui::CollapsingHeader("Frame times"))
+            {
+                ImGui::Text("last %d frames, %.2f to %.0f ms on a log scale", HISTOGRAM_SAMPLES, bucket_ms(0), bucket_ms(HISTOGRAM_BUCKETS));
+                draw_histogram("frame", game.histograms.frame);
+                draw_histogram("step", game.histograms.step);
+                draw_histogram("input to photon", game.histograms.latency);
+            }
+
+            if (ImGui::Button("screenshot"))
+                game.capture.screenshot = true;
+            ImGui::SameLine();
+            if (!game.capture.recording && ImGui::Button("record"))
+            {
+                snprintf(filename, sizeof(filename), "conway-%llu.y4m", (unsigned long long)universe.generation);
+                start_recording(game, filename);
+            }
+            else if (game.capture.recording && ImGui::Button("stop recording"))
+            {
+                stop_recording(game);
+            }
+            if (game.capture.in_flight)
+                ImGui::Text("%d captures in flight", game.capture.in_flight);
+            if (capture_failed(game.capture))
+                ImGui::Text("a capture failed to write, see the log");
 
         ImGui::End();
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            Zone zone("imgui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_SetRingBuffer(game.render.imgui_ring);
+            gpu_timer_begin(game, GPU_PASS_IMGUI);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            gpu_timer_end(game);
+            gpu_timers_end_frame(game);
+        }
+
+        {
+            Zone zone("swap");
+            glfwSwapBuffers(game.window);
+        }
+        end_profile_frame(game);
 
-        glfwSwapBuffers(game.window);
+        // an estimate, input that arrived after the frame read it waits for the next one
+        double presented = glfwGetTime();
+        if (game.time.presented > 0.0)
+            add_sample(game.histograms.frame, (float)(presented - game.time.presented) * 1000.0f);
+        add_sample(game.histograms.latency, (float)(presented - game.time.input + game.time.refresh) * 1000.0f);
+        game.time.presented = presented;
+        poll_trace(game);
     }
 
+    shutdown_capture(game);
+    stop_pool(game.pool);
+    close_perf_counters(game.perf);
+
     return 0;
-}
\ No newline at end of file
+}
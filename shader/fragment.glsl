@@ -1,8 +1,108 @@
 #version 330 core
-out vec4 FragColor;  
-in vec3 ourColor;
-  
+out vec4 FragColor;
+
+uniform int mode;
+uniform vec2 viewport;
+uniform vec2 view_origin;
+uniform float cell_size;
+uniform ivec4 region;       // x, y, width, height of the cells uploaded to the texture
+uniform sampler2D cells;    // r = alive, g = age
+uniform vec4 ourColor;
+
+uniform int color_mode;     // 0 = plain, 1 = age, 2 = age and trails
+uniform sampler2D palette;  // 256x2, row 0 by age of live cells, row 1 by trail left on dead cells
+
+flat in int state;
+
+// overlay pass
+uniform ivec2 universe_size;
+uniform ivec2 hover;        // -1, -1 when the cursor isn't over the universe
+uniform ivec4 selection;    // x, y, width, height, zero sized when nothing is selected
+
+const vec4 background = vec4(0.0, 0.0, 0.0, 1.0);
+const vec4 grid_color = vec4(0.35, 0.35, 0.35, 0.6);
+const vec4 hover_color = vec4(1.0, 0.85, 0.2, 0.45);
+const vec4 selection_fill = vec4(0.2, 0.5, 1.0, 0.2);
+const vec4 selection_edge = vec4(0.3, 0.6, 1.0, 0.9);
+
+// grid lines only start to show once cells are this many pixels wide
+const float GRID_MIN_CELL_SIZE = 4.0;
+const float GRID_FADE = 8.0;
+
+vec4 over(vec4 top, vec4 bottom)
+{
+    float a = top.a + bottom.a * (1.0 - top.a);
+    if (a == 0.0)
+        return vec4(0.0);
+    return vec4((top.rgb * top.a + bottom.rgb * bottom.a * (1.0 - top.a)) / a, a);
+}
+
+vec4 shade(bool alive, int age)
+{
+    if (alive)
+        return color_mode == 0 ? ourColor : texelFetch(palette, ivec2(age, 0), 0);
+    if (color_mode == 2)
+        return texelFetch(palette, ivec2(age, 1), 0);
+    return background;
+}
+
+vec4 overlay(vec2 px, vec2 cell)
+{
+    ivec2 c = ivec2(floor(cell));
+    if (any(lessThan(c, ivec2(0))) || any(greaterThanEqual(c, universe_size)))
+        return vec4(0.0);
+
+    vec4 color = vec4(0.0);
+
+    // one pixel line along the top and left edge of every cell
+    vec2 inside = fract(cell) * cell_size;
+    if (cell_size >= GRID_MIN_CELL_SIZE && (inside.x < 1.0 || inside.y < 1.0))
+    {
+        float fade = clamp((cell_size - GRID_MIN_CELL_SIZE) / GRID_FADE, 0.0, 1.0);
+        color = vec4(grid_color.rgb, grid_color.a * fade);
+    }
+
+    if (selection.z > 0)
+    {
+        vec2 lo = (vec2(selection.xy) - view_origin) * cell_size;
+        vec2 hi = (vec2(selection.xy + selection.zw) - view_origin) * cell_size;
+        if (all(greaterThanEqual(px, lo)) && all(lessThan(px, hi)))
+        {
+            vec2 edge = min(px - lo, hi - px);
+            color = over(min(edge.x, edge.y) < 1.5 ? selection_edge : selection_fill, color);
+        }
+    }
+
+    if (c == hover)
+        color = over(hover_color, color);
+
+    return color;
+}
+
 void main()
 {
-    FragColor = vec4(ourColor, 1.0);
+    vec2 px = vec2(gl_FragCoord.x, viewport.y - gl_FragCoord.y);
+    vec2 cell = view_origin + px / cell_size;
+
+    if (mode == 2)
+    {
+        FragColor = overlay(px, cell);
+        return;
+    }
+
+    if (mode == 1)
+    {
+        FragColor = shade((state >> 8) != 0, state & 255);
+        return;
+    }
+
+    ivec2 c = ivec2(floor(cell)) - region.xy;
+    if (any(lessThan(c, ivec2(0))) || any(greaterThanEqual(c, region.zw)))
+    {
+        FragColor = background;
+        return;
+    }
+
+    vec2 texel = texelFetch(cells, c, 0).rg;
+    FragColor = shade(texel.r > 0.0, int(texel.g * 255.0 + 0.5));
 }
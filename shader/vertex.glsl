@@ -1,13 +1,26 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
-layout (location = 1) in vec3 aColor; // the color variable has attribute position 1
+layout (location = 0) in ivec3 aCell; // x, y, alive << 8 | age, only used when drawing instanced
 
-uniform vec3 offset;
+uniform int mode;           // 0 = full-screen texture lookup, 1 = one instanced quad per live cell, 2 = full-screen overlay
+uniform vec2 viewport;      // framebuffer size in pixels
+uniform vec2 view_origin;   // cell coordinate at the top left corner of the screen
+uniform float cell_size;    // pixels per cell
 
-out vec3 ourColor; // output a color to the fragment shader
+flat out int state;
 
 void main()
 {
-    gl_Position = vec4(offset + aPos, 1.0);
-    ourColor = aColor; // set ourColor to the input color we got from the vertex data
+    if (mode != 1)
+    {
+        // one triangle covering the screen, the fragment shader works out which cell it is in
+        vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+    }
+    else
+    {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        vec2 px = (vec2(aCell.xy) - view_origin + corner) * cell_size;
+        gl_Position = vec4(px.x / viewport.x * 2.0 - 1.0, 1.0 - px.y / viewport.y * 2.0, 0.0, 1.0);
+        state = aCell.z;
+    }
 }
@@ -0,0 +1,125 @@
+// bakes the shaders and ImGui's default font atlas into a header, so the game
+// reads no files and rasterizes no glyphs at startup
+//
+//   bake_assets shader/vertex.glsl shader/fragment.glsl obj/assets.h
+
+#include "imgui/imgui.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// bytes as a comma separated initializer, wrapped so compilers don't choke on long lines
+void write_bytes(std::ostream &out, unsigned char const *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        out << (int)data[i] << ',';
+        if (i % 32 == 31)
+            out << '\n';
+    }
+}
+
+// floats written exactly, so the baked glyphs match what ImGui would have built
+std::string exact(float value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%af", value);
+    return buffer;
+}
+
+int write_source(std::ostream &out, char const *name, char const *filename)
+{
+    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+    if (!file)
+    {
+        std::cout << "Failed to open " << filename << std::endl;
+        return -1;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string source = text.str();
+
+    out << "// " << filename << "\n";
+    out << "constexpr char " << name << "[] = {\n";
+    write_bytes(out, (unsigned char const *)source.data(), source.size());
+    out << "0};\n\n";
+    return 0;
+}
+
+void write_font(std::ostream &out)
+{
+    ImFontAtlas atlas;
+    ImFont *font = atlas.AddFontDefault();
+
+    unsigned char *pixels;
+    int width, height;
+    atlas.GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    out << "// " << font->ConfigData->Name << ", alpha only\n";
+    out << "constexpr int FONT_ATLAS_WIDTH = " << width << ";\n";
+    out << "constexpr int FONT_ATLAS_HEIGHT = " << height << ";\n";
+    out << "constexpr float FONT_WHITE_PIXEL[2] = {" << exact(atlas.TexUvWhitePixel.x) << ", " << exact(atlas.TexUvWhitePixel.y) << "};\n";
+    out << "constexpr float FONT_SIZE = " << exact(font->FontSize) << ";\n";
+    out << "constexpr float FONT_ASCENT = " << exact(font->Ascent) << ";\n";
+    out << "constexpr float FONT_DESCENT = " << exact(font->Descent) << ";\n";
+    out << "constexpr float FONT_DISPLAY_OFFSET[2] = {" << exact(font->DisplayOffset.x) << ", " << exact(font->DisplayOffset.y) << "};\n";
+    out << "constexpr unsigned short FONT_FALLBACK_CHAR = " << (int)font->FallbackChar << ";\n";
+    out << "constexpr int FONT_MOUSE_CURSOR_RECT = " << atlas.CustomRectIds[0] << ";\n\n";
+
+    out << "constexpr unsigned char FONT_ATLAS_PIXELS[] = {\n";
+    write_bytes(out, pixels, (size_t)width * height);
+    out << "};\n\n";
+
+    // the tab glyph is left out, BuildLookupTable adds it back
+    out << "// codepoint, advance, x0, y0, x1, y1, u0, v0, u1, v1\n";
+    out << "constexpr BakedGlyph FONT_GLYPHS[] = {\n";
+    for (ImFontGlyph const &glyph : font->Glyphs)
+    {
+        if (glyph.Codepoint == '\t')
+            continue;
+        out << "{" << glyph.Codepoint << ", " << exact(glyph.AdvanceX)
+            << ", " << exact(glyph.X0) << ", " << exact(glyph.Y0) << ", " << exact(glyph.X1) << ", " << exact(glyph.Y1)
+            << ", " << exact(glyph.U0) << ", " << exact(glyph.V0) << ", " << exact(glyph.U1) << ", " << exact(glyph.V1) << "},\n";
+    }
+    out << "};\n\n";
+
+    // ImGui's own rectangles, the mouse cursors live in one of them
+    out << "// id, width, height, x, y\n";
+    out << "constexpr BakedRect FONT_RECTS[] = {\n";
+    for (ImFontAtlas::CustomRect const &rect : atlas.CustomRects)
+        out << "{" << rect.ID << "u, " << rect.Width << ", " << rect.Height << ", " << rect.X << ", " << rect.Y << "},\n";
+    out << "};\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4)
+    {
+        std::cout << "usage: " << argv[0] << " vertex.glsl fragment.glsl assets.h" << std::endl;
+        return 1;
+    }
+
+    std::stringstream out;
+    out << "// generated by tools/bake_assets, don't edit\n";
+    out << "#pragma once\n\n";
+    out << "struct BakedGlyph\n{\n    unsigned short codepoint;\n    float advance;\n    float x0, y0, x1, y1;\n    float u0, v0, u1, v1;\n};\n\n";
+    out << "struct BakedRect\n{\n    unsigned int id;\n    unsigned short width, height;\n    unsigned short x, y;\n};\n\n";
+
+    if (write_source(out, "VERTEX_SHADER_SOURCE", argv[1]) < 0 || write_source(out, "FRAGMENT_SHADER_SOURCE", argv[2]) < 0)
+        return 1;
+    write_font(out);
+
+    std::ofstream file(argv[3], std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    file << out.str();
+    file.close();
+    if (!file)
+    {
+        std::cout << "Failed to write " << argv[3] << std::endl;
+        return 1;
+    }
+    return 0;
+}